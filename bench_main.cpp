@@ -0,0 +1,471 @@
+#include "BatchRunner.hpp"
+#include "Distribution.hpp"
+#include "ThreadPool.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <sys/stat.h>
+
+// One measured case. `params` values are JSON literals.
+struct BenchResult
+{
+	std::string										name;
+	std::vector<std::pair<std::string, std::string> >	params;
+	size_t											ops;
+	double											seconds;	// Best run
+	size_t											bytes;		// 0 = n/a
+};
+
+// Microbenchmarks of the pipeline stages. Every case runs until it has
+// taken at least _minTime (and at least 3 times) and keeps its fastest run.
+class Benchmark
+{
+	public:
+		Benchmark(bool quick, const std::string &dir);
+		~Benchmark(void);
+
+		void	run(void);
+		void	printJSON(std::ostream &out) const;
+
+	private:
+		bool						_quick;
+		std::string					_dir;
+		double						_minTime;
+		std::vector<BenchResult>	_results;
+
+		double	best(const std::function<void(void)> &job) const;
+		void	record(const std::string &name,
+					const std::vector<std::pair<std::string, std::string> >
+					&params, size_t ops, double seconds, size_t bytes);
+		void	benchSampling(void);
+		void	benchSimulation(void);
+		void	benchStatistics(void);
+		void	benchExport(void);
+
+		static void	makePaytable(Distribution &dist, const std::string &mode,
+						size_t rows);
+		static size_t	fileSize(const std::string &path);
+};
+
+// The export stages of Distribution, which are private: the only friend
+// access the bench gets.
+struct DistributionBench
+{
+	static void	formatSimulation(const Distribution &dist, std::string &out,
+					const SimulationStore &store, size_t row)
+	{
+		dist.formatSimulation(out, store, row);
+	}
+
+	static bool	exportCSV(const Distribution &dist, const std::string &path,
+					const std::string &mode, const SimulationStore &store,
+					const ExportOptions &options, std::string &error)
+	{
+		return (dist.exportCSV(path, mode, store, options, error));
+	}
+
+	static bool	exportJSONLCompressed(const Distribution &dist,
+					const std::string &path, const std::string &mode,
+					const SimulationStore &store,
+					const ExportOptions &options,
+					const std::string &dictionary, std::string &error)
+	{
+		return (dist.exportJSONLCompressed(path, mode, store, options,
+			dictionary, error));
+	}
+
+	static bool	trainDictionary(const Distribution &dist,
+					const std::string &mode, const SimulationStore &store,
+					size_t capacity, size_t sampleBooks,
+					std::string &dictionary)
+	{
+		return (dist.trainDictionary(mode, store, capacity, sampleBooks,
+			dictionary));
+	}
+};
+
+static std::string	quote(const std::string &text)
+{
+	return ("\"" + text + "\"");
+}
+
+Benchmark::Benchmark(bool quick, const std::string &dir)
+	: _quick(quick), _dir(dir), _minTime(quick ? 0.05 : 0.3)
+{
+}
+
+Benchmark::~Benchmark(void)
+{
+}
+
+double	Benchmark::best(const std::function<void(void)> &job) const
+{
+	double	total;
+	double	fastest;
+	size_t	runs;
+
+	total = 0.0;
+	fastest = 0.0;
+	for (runs = 0; runs < 3 || (total < _minTime && runs < 1000); runs++)
+	{
+		auto	start = std::chrono::steady_clock::now();
+
+		job();
+		double	seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+
+		total += seconds;
+		if (runs == 0 || seconds < fastest)
+			fastest = seconds;
+	}
+	return (fastest);
+}
+
+void	Benchmark::record(const std::string &name,
+		const std::vector<std::pair<std::string, std::string> > &params,
+		size_t ops, double seconds, size_t bytes)
+{
+	BenchResult	result;
+
+	result.name = name;
+	result.params = params;
+	result.ops = ops;
+	result.seconds = seconds;
+	result.bytes = bytes;
+	_results.push_back(result);
+	std::cerr << "  " << std::left << std::setw(24) << name << std::right
+			  << std::fixed << std::setprecision(2) << std::setw(12)
+			  << seconds * 1e9 / ops << " ns/op";
+	if (bytes > 0)
+		std::cerr << std::setw(12) << bytes / seconds / 1e6 << " MB/s";
+	std::cerr << std::endl;
+}
+
+// Geometric payouts 0, 0.1x, 0.2x, 0.4x... with decreasing weights.
+void	Benchmark::makePaytable(Distribution &dist, const std::string &mode,
+		size_t rows)
+{
+	dist.addMode(mode, 1.0);
+	for (size_t i = 0; i < rows; i++)
+		dist.addMultiplier(mode, i == 0 ? 0.0 : 0.1 * (1 << (i % 16)),
+			1000000 / (i + 1) + 1);
+}
+
+size_t	Benchmark::fileSize(const std::string &path)
+{
+	struct stat	info;
+
+	if (stat(path.c_str(), &info) != 0)
+		return (0);
+	return (static_cast<size_t>(info.st_size));
+}
+
+// samplePayouts: pickMultiplier's alias-table draw plus the payout lookup,
+// for both engines (Philox is re-keyed per round, as in simulateBlock).
+void	Benchmark::benchSampling(void)
+{
+	static const size_t			SIZES[] = {2, 8, 64, 1024, 65536};
+	static const RngEngine		ENGINES[] = {RNG_MT19937, RNG_PHILOX};
+	static const char			*NAMES[] = {"mt19937", "philox"};
+	std::vector<uint64_t>		payouts(_quick ? 200000 : 2000000);
+
+	for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); s++)
+	{
+		Distribution	dist;
+
+		makePaytable(dist, "bench", SIZES[s]);
+		for (size_t e = 0; e < 2; e++)
+			record("samplePayouts", {{"rows", std::to_string(SIZES[s])},
+				{"engine", quote(NAMES[e])}}, payouts.size(), best([&]() {
+				dist.samplePayouts("bench", 42, ENGINES[e], payouts);
+			}), 0);
+	}
+}
+
+// runSimulations end to end (generation, statistics, events).
+void	Benchmark::benchSimulation(void)
+{
+	std::vector<size_t>	counts;
+	std::vector<size_t>	threads;
+	size_t				hardware;
+	Distribution		dist;
+
+	counts = _quick ? std::vector<size_t>{100000, 1000000}
+		: std::vector<size_t>{100000, 1000000, 10000000};
+	hardware = ThreadPool::resolveThreads(0);
+	for (size_t t = 1; t < hardware; t *= 2)
+		threads.push_back(t);
+	threads.push_back(hardware);
+	makePaytable(dist, "bench", 16);
+	for (size_t c = 0; c < counts.size(); c++)
+	{
+		for (size_t t = 0; t < threads.size(); t++)
+		{
+			SimulationOptions	options;
+
+			options.threads = threads[t];
+			record("runSimulations", {{"rounds", std::to_string(counts[c])},
+				{"threads", std::to_string(threads[t])}}, counts[c],
+				best([&]() {
+					dist.runSimulations("bench", counts[c], 42, options);
+				}), 0);
+		}
+	}
+}
+
+// Every getter on a simulated mode (cached after runSimulations), plus the
+// fused statistics pass itself.
+void	Benchmark::benchStatistics(void)
+{
+	const size_t		rounds = _quick ? 200000 : 1000000;
+	const size_t		calls = 100000;
+	Distribution		dist;
+	volatile double		sink;
+
+	typedef double	(Distribution::*Getter)(const std::string &) const;
+	static const std::pair<const char *, Getter>	GETTERS[] = {
+		{"getRTP", &Distribution::getRTP},
+		{"getMeanPayout", &Distribution::getMeanPayout},
+		{"getVariance", &Distribution::getVariance},
+		{"getStandardDeviation", &Distribution::getStandardDeviation},
+		{"getVolatility", &Distribution::getVolatility},
+		{"getHitFrequency", &Distribution::getHitFrequency},
+		{"getMinPayout", &Distribution::getMinPayout},
+		{"getMaxPayout", &Distribution::getMaxPayout}
+	};
+
+	makePaytable(dist, "bench", 16);
+	dist.runSimulations("bench", rounds, 42);
+	for (size_t g = 0; g < sizeof(GETTERS) / sizeof(GETTERS[0]); g++)
+	{
+		Getter	getter = GETTERS[g].second;
+
+		record(GETTERS[g].first, {}, calls, best([&]() {
+			double	sum = 0.0;
+
+			for (size_t i = 0; i < calls; i++)
+				sum += (dist.*getter)("bench");
+			sink = sum;
+		}), 0);
+	}
+	record("getRTPHalfWidth", {}, calls, best([&]() {
+		double	sum = 0.0;
+
+		for (size_t i = 0; i < calls; i++)
+			sum += dist.getRTPHalfWidth("bench", 0.99);
+		sink = sum;
+	}), 0);
+	record("analyzeMode", {{"rows", "16"}}, calls, best([&]() {
+		double	sum = 0.0;
+
+		for (size_t i = 0; i < calls; i++)
+			sum += dist.analyzeMode("bench").stats.rtp;
+		sink = sum;
+	}), 0);
+
+	const SimulationStore	&store = dist.getSimulations("bench");
+
+	record("PayoutMoments::add", {{"rounds", std::to_string(rounds)}},
+		rounds, best([&]() {
+			PayoutMoments	moments;
+
+			moments.add(store, 0, store.size());
+			sink = static_cast<double>(moments.count);
+		}), 0);
+	(void)sink;
+}
+
+// Formatting, the lookup table and the compressed books. MB/s is measured
+// on the bytes written (CSV) or formatted before compression (JSONL).
+void	Benchmark::benchExport(void)
+{
+	const size_t		rounds = _quick ? 200000 : 1000000;
+	const std::string	csvPath = _dir + "/bench.csv";
+	const std::string	booksPath = _dir + "/bench.jsonl.zst";
+	Distribution		dist;
+	std::string			line;
+	std::string			error;
+	size_t				jsonlBytes;
+	size_t				csvBytes;
+
+	makePaytable(dist, "bench", 16);
+	dist.runSimulations("bench", rounds, 42);
+	const SimulationStore	&store = dist.getSimulations("bench");
+
+	jsonlBytes = 0;
+	for (size_t i = 0; i < store.size(); i++)
+	{
+		line.clear();
+		DistributionBench::formatSimulation(dist, line, store, i);
+		jsonlBytes += line.size() + 1;
+	}
+	record("formatSimulation", {{"rounds", std::to_string(rounds)}}, rounds,
+		best([&]() {
+			for (size_t i = 0; i < store.size(); i++)
+			{
+				line.clear();
+				DistributionBench::formatSimulation(dist, line, store, i);
+			}
+		}), jsonlBytes);
+
+	for (size_t threads = 1; threads <= 4; threads *= 4)
+	{
+		ExportOptions	options;
+
+		options.csvThreads = threads;
+		double	seconds = best([&]() {
+			DistributionBench::exportCSV(dist, csvPath, "bench", store,
+				options, error);
+		});
+
+		csvBytes = fileSize(csvPath);
+		record("exportCSV", {{"rounds", std::to_string(rounds)},
+			{"threads", std::to_string(threads)}}, rounds, seconds, csvBytes);
+	}
+
+	const std::pair<const char *, CompressionSettings>	PRESETS[] = {
+		{"default", CompressionSettings()},
+		{"fast", CompressionSettings::fast()},
+		{"small", CompressionSettings::small()}
+	};
+
+	for (size_t p = 0; p < sizeof(PRESETS) / sizeof(PRESETS[0]); p++)
+	{
+		ExportOptions	options;
+
+		options.compression = PRESETS[p].second;
+		double	seconds = best([&]() {
+			DistributionBench::exportJSONLCompressed(dist, booksPath,
+				"bench", store, options, std::string(), error);
+		});
+
+		record("exportJSONLCompressed", {{"rounds", std::to_string(rounds)},
+			{"compression", quote(PRESETS[p].first)},
+			{"outputBytes", std::to_string(fileSize(booksPath))}}, rounds,
+			seconds, jsonlBytes);
+	}
+
+	// Seekable frames of 256 books, without and with a trained dictionary
+	std::string	dictionary;
+
+	record("trainDictionary", {{"rounds", std::to_string(rounds)},
+		{"capacity", "112640"}}, 1, best([&]() {
+			DistributionBench::trainDictionary(dist, "bench", store, 112640,
+				256, dictionary);
+		}), 0);
+	for (size_t d = 0; d < 2; d++)
+	{
+		ExportOptions	options;
+
+		options.booksPerFrame = 256;
+		double	seconds = best([&]() {
+			DistributionBench::exportJSONLCompressed(dist, booksPath,
+				"bench", store, options, d ? dictionary : std::string(),
+				error);
+		});
+
+		record("exportJSONLCompressed", {{"rounds", std::to_string(rounds)},
+			{"compression", quote("default")}, {"booksPerFrame", "256"},
+			{"dictionary", d ? "true" : "false"},
+			{"outputBytes", std::to_string(fileSize(booksPath))}}, rounds,
+			seconds, jsonlBytes);
+	}
+
+	// End to end, simulating then exporting against the streaming pipeline
+	ExportOptions	quiet;
+
+	quiet.verbose = false;
+	record("runSimulations+exportAll", {{"rounds", std::to_string(rounds)}},
+		rounds, best([&]() {
+			dist.runSimulations("bench", rounds, 42);
+			dist.exportAll(_dir, quiet);
+		}), jsonlBytes);
+	record("streamSimulations", {{"rounds", std::to_string(rounds)}},
+		rounds, best([&]() {
+			dist.streamSimulations("bench", rounds, 42, _dir,
+				SimulationOptions(), quiet);
+		}), jsonlBytes);
+}
+
+void	Benchmark::run(void)
+{
+	std::cerr << "Sampling" << std::endl;
+	benchSampling();
+	std::cerr << "Simulation" << std::endl;
+	benchSimulation();
+	std::cerr << "Statistics" << std::endl;
+	benchStatistics();
+	std::cerr << "Export" << std::endl;
+	benchExport();
+}
+
+void	Benchmark::printJSON(std::ostream &out) const
+{
+	out << "{\n";
+	out << "  \"benchmark\": \"math-engine\",\n";
+#ifdef __OPTIMIZE__
+	out << "  \"optimized\": true,\n";
+#else
+	out << "  \"optimized\": false,\n";
+#endif
+	out << "  \"hardwareThreads\": " << ThreadPool::resolveThreads(0)
+		<< ",\n";
+	out << "  \"quick\": " << (_quick ? "true" : "false") << ",\n";
+	out << "  \"results\": [\n";
+	out << std::setprecision(6);
+	for (size_t r = 0; r < _results.size(); r++)
+	{
+		const BenchResult	&result = _results[r];
+
+		out << "    {\"name\": " << quote(result.name) << ", \"params\": {";
+		for (size_t p = 0; p < result.params.size(); p++)
+			out << (p ? ", " : "") << quote(result.params[p].first) << ": "
+				<< result.params[p].second;
+		out << "}, \"ops\": " << result.ops
+			<< ", \"seconds\": " << std::scientific << result.seconds
+			<< std::fixed
+			<< ", \"nsPerOp\": " << result.seconds * 1e9 / result.ops
+			<< ", \"opsPerSecond\": " << result.ops / result.seconds;
+		if (result.bytes > 0)
+			out << ", \"bytes\": " << result.bytes
+				<< ", \"mbPerSecond\": " << result.bytes / result.seconds
+				/ 1e6;
+		out << "}" << (r + 1 < _results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+// JSON results go to stdout, progress to stderr. Exports go to a scratch
+// directory, removed at the end.
+int	main(int argc, char **argv)
+{
+	bool		quick;
+	std::string	dir;
+
+	quick = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--quick") == 0)
+			quick = true;
+		else
+		{
+			std::cerr << "Usage: math-engine-bench [--quick]" << std::endl;
+			return (1);
+		}
+	}
+	if (!BatchRunner::createScratchDirectory("math-engine-bench", dir))
+	{
+		std::cerr << "Error: cannot create a scratch directory" << std::endl;
+		return (1);
+	}
+	Benchmark	bench(quick, dir);
+
+	bench.run();
+	BatchRunner::removeDirectories(dir);
+	bench.printJSON(std::cout);
+	return (0);
+}
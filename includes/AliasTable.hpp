@@ -0,0 +1,44 @@
+#ifndef ALIASTABLE_HPP
+# define ALIASTABLE_HPP
+
+# include <vector>
+# include <cstdint>
+# include <cstddef>
+# include "Random.hpp"
+
+// Walker/Vose alias table over integer weights.
+// Each column holds exactly totalWeight units of mass, split between its own
+// entry (below threshold) and its alias, so a draw is exact and O(1).
+class AliasTable
+{
+	public:
+		AliasTable(void);
+		~AliasTable(void);
+
+		void		build(const std::vector<uint64_t> &weights);
+		size_t		size(void) const;
+		bool		empty(void) const;
+
+		template <class Rng>
+		size_t		sample(Rng &rng) const;
+
+	private:
+		std::vector<uint64_t>	_threshold;
+		std::vector<uint32_t>	_alias;
+		uint64_t				_totalWeight;
+};
+
+template <class Rng>
+size_t	AliasTable::sample(Rng &rng) const
+{
+	size_t		column;
+	uint64_t	roll;
+
+	column = static_cast<size_t>(randomBelow(rng, _threshold.size()));
+	roll = randomBelow(rng, _totalWeight);
+	if (roll < _threshold[column])
+		return (column);
+	return (_alias[column]);
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef BATCHRUNNER_HPP
+# define BATCHRUNNER_HPP
+
+# include <vector>
+# include <string>
+# include <ostream>
+# include "GameConfig.hpp"
+
+// Outcome of one mode of one game.
+struct BatchModeResult
+{
+	std::string	game;
+	std::string	mode;
+	size_t		simulations;
+	double		rtp;
+	double		halfWidth;		// 99% confidence interval on rtp
+	double		exactRtp;		// From the paytable
+	double		seconds;		// Solving and simulation time
+	bool		ok;
+	std::string	error;
+};
+
+// Outcome of one game: its modes, then the export of its output directory.
+struct BatchGameResult
+{
+	std::string						name;
+	std::string						outputDir;
+	std::vector<BatchModeResult>	modes;
+	double							exportSeconds;
+	std::string						error;		// Empty on success
+};
+
+// Runs many games on one shared worker pool. Every mode of every game is a
+// task (solve its weights if asked, simulate, verify its RTP); once the
+// last mode of a game is done, its export is queued on the same pool and
+// its simulations are released right after it. Each task runs
+// single-threaded (simulation threads, csvThreads and compression workers
+// are forced to 1/0): the pool already keeps every core busy. Modes of a
+// streaming game are exported by streamSimulations while they run (with
+// its two writer threads), and the game's export task only writes
+// index.json.
+class BatchRunner
+{
+	public:
+		explicit BatchRunner(size_t threads);
+		~BatchRunner(void);
+
+		bool							add(const GameConfig &config,
+											const std::string &outputDir,
+											std::string &error);
+		void							addFailure(const std::string &name,
+											const std::string &error);
+		bool							run(void);
+		const std::vector<BatchGameResult>	&results(void) const;
+		void							printSummary(std::ostream &out) const;
+
+		static bool						loadDirectory(const std::string &dir,
+											std::vector<std::string> &paths,
+											std::string &error);
+		static bool						createDirectories(
+											const std::string &path);
+		static bool						removeDirectories(
+											const std::string &path);
+		static bool						createScratchDirectory(
+											const std::string &prefix,
+											std::string &path);
+
+	private:
+		size_t							_threads;
+		std::vector<GameConfig>			_configs;
+		std::vector<BatchGameResult>	_results;
+		double							_seconds;
+
+		BatchRunner(const BatchRunner &other);
+		BatchRunner	&operator=(const BatchRunner &other);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef BLOCKRING_HPP
+# define BLOCKRING_HPP
+
+# include <vector>
+# include <string>
+# include <mutex>
+# include <condition_variable>
+# include <cstddef>
+# include "SimulationStore.hpp"
+
+// One simulated block on its way through Distribution::streamSimulations.
+// Slots are reused, so the buffers keep their capacity from block to block.
+struct StreamBlock
+{
+	size_t				index;
+	SimulationStore		store;		// Rounds of the block
+	std::string			books;		// JSONL lines
+	std::vector<size_t>	frameEnds;	// Offsets in books where a frame ends
+	std::string			lookup;		// CSV rows
+};
+
+// Bounded, ordered hand-off between the producers of a stream and its
+// consumers. Block i lives in slot i % capacity: a producer reserves it
+// (waiting while block i - capacity is still in use), fills it and
+// publishes it; each consumer acquires blocks in index order and releases
+// them. At most `capacity` blocks are alive at once, whatever the speed of
+// each stage. With no consumers a block is freed as soon as it is
+// published.
+class BlockRing
+{
+	public:
+		BlockRing(size_t capacity, size_t consumers);
+		~BlockRing(void);
+
+		StreamBlock			*reserve(size_t index);	// NULL once cancelled
+		void				publish(size_t index);
+		const StreamBlock	*acquire(size_t index);	// NULL once cancelled
+		void				release(size_t index);
+		void				cancel(void);
+		bool				cancelled(void) const;
+
+	private:
+		struct Slot
+		{
+			StreamBlock	block;
+			size_t		next;		// Only block allowed in the slot
+			size_t		pending;	// Consumers yet to release it
+			bool		ready;		// Published
+		};
+
+		mutable std::mutex			_mutex;
+		std::condition_variable		_changed;
+		std::vector<Slot>			_slots;
+		size_t						_consumers;
+		bool						_cancelled;
+
+		BlockRing(const BlockRing &other);
+		BlockRing	&operator=(const BlockRing &other);
+
+		void				free(Slot &slot);
+};
+
+#endif
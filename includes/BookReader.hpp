@@ -0,0 +1,57 @@
+#ifndef BOOKREADER_HPP
+# define BOOKREADER_HPP
+
+# include <vector>
+# include <string>
+# include <cstdint>
+# include <zstd.h>
+
+// Random access to a seekable books file (ExportOptions::booksPerFrame).
+// open() reads the seek table from the footer and decompresses the first
+// frame once to learn how many books a frame holds. read(id) then fetches
+// and decompresses only the frame of book `id` (one pread and one
+// ZSTD_decompressDCtx on a reused context); the last frame stays cached,
+// so neighbouring ids cost a lookup.
+//
+// Frames compressed with a dictionary are decoded through a ZSTD_DDict
+// built once in open(), from `dictionary` or, by default, from the
+// books_<mode>.dict written next to the books file.
+class BookReader
+{
+	public:
+		BookReader(void);
+		~BookReader(void);
+
+		bool				open(const std::string &path,
+								const std::string &dictionary = std::string());
+		bool				read(uint64_t id, std::string &book);
+		void				close(void);
+
+		size_t				frameCount(void) const;
+		uint64_t			booksPerFrame(void) const;
+		const std::string	&error(void) const;
+
+	private:
+		int						_fd;
+		ZSTD_DCtx				*_dctx;
+		ZSTD_DDict				*_ddict;
+		std::vector<uint64_t>	_offsets;		// Compressed, frames + 1
+		std::vector<uint32_t>	_sizes;			// Decompressed
+		uint64_t				_booksPerFrame;
+		std::vector<char>		_compressed;
+		std::vector<char>		_frame;			// Decompressed, cached
+		std::vector<size_t>		_lines;			// Line starts in _frame
+		size_t					_cached;		// Frame in _frame
+		std::string				_error;
+
+		BookReader(const BookReader &other);
+		BookReader	&operator=(const BookReader &other);
+
+		bool				readSeekTable(void);
+		bool				loadDictionary(const std::string &path,
+								const std::string &dictionary);
+		bool				loadFrame(size_t frame);
+		bool				fail(const std::string &message);
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef CSVWRITER_HPP
+# define CSVWRITER_HPP
+
+# include <vector>
+# include <string>
+# include <cstdint>
+# include "SimulationStore.hpp"
+
+// Writes lookup tables ("id,weight,payoutMultiplier" rows) with std::to_chars
+// into a large block buffer flushed through write(2).
+//
+// With several threads the rows are split into segments: the byte size of
+// every segment is computed first (digit counting only), the file is sized
+// once, then each segment is formatted and pwrite()n at its own offset.
+// appendRows() formats rows into a caller's buffer instead, for writers
+// that get the table a block at a time.
+class CsvWriter
+{
+	public:
+		static const size_t	BUFFER_SIZE = 4 * 1024 * 1024;
+
+		CsvWriter(void);
+		~CsvWriter(void);
+
+		bool				write(const std::string &path,
+								const SimulationStore &store,
+								size_t threads, bool preallocate);
+		const std::string	&error(void) const;
+
+		static void			appendRows(std::string &out,
+								const SimulationStore &store,
+								size_t first, size_t last);
+
+	private:
+		std::string			_error;
+
+		static size_t		rowsSize(const SimulationStore &store,
+								size_t first, size_t last);
+		static bool			writeRows(int fd, const SimulationStore &store,
+								size_t first, size_t last, off_t offset,
+								std::vector<char> &buffer);
+		bool				fail(const std::string &message);
+};
+
+#endif
@@ -6,60 +6,191 @@
 # include <cstdint>
 # include <random>
 # include <map>
+# include <atomic>
 # include <zstd.h>
+# include "AliasTable.hpp"
+# include "SimulationStore.hpp"
+# include "Statistics.hpp"
+# include "ZstdWriter.hpp"
+# include "WeightSolver.hpp"
+
+class ThreadPool;
+class BlockRing;
+struct StreamBlock;
 
 struct MultiplierConfig
 {
 	double		multiplier;
 	uint64_t	weight;
+	uint64_t	payout;		// In PAYOUT_SCALE units, rounded from multiplier
 };
 
-// Game event: what happens DURING a single game round
-// Types: "reveal", "winInfo", "setWin", "finalWin"
-struct GameEvent
-{
-	int			index;
-	std::string	type;
-	double		multiplier;
-	int			amount;
-
-	GameEvent(void);
-	GameEvent(int idx, const std::string &t, double mult, int amt);
-};
-
-// A single simulation/round result
+// A single simulation/round result, detached from the mode's
+// SimulationStore (e.g. returned by replaySimulation)
 struct Simulation
 {
 	uint64_t				id;
 	uint64_t				weight;
-	uint64_t				payoutMultiplier;	// In hundredths: 150 = 1.5x
+	uint64_t				payoutMultiplier;	// x PAYOUT_SCALE: 150 = 1.5x
 	std::vector<GameEvent>	events;				// Game events (reveal, finalWin, etc.)
 };
 
+// Random engines available to runSimulations.
+// RNG_MT19937: one mt19937_64 stream per block of BLOCK_SIZE rounds.
+// RNG_PHILOX: counter-based, round N is a pure function of
+// (seed, mode, N) and can be replayed on its own.
+enum RngEngine
+{
+	RNG_MT19937,
+	RNG_PHILOX
+};
+
+// GENERATE_ROUNDS draws every round from the alias table.
+// GENERATE_MULTINOMIAL draws how many rounds land on each multiplier at once
+// (k binomials), then fills the rows grouped by multiplier, or in a random
+// order with `shuffle`. Both yield i.i.d. rounds, not the same ones.
+enum GenerationMode
+{
+	GENERATE_ROUNDS,
+	GENERATE_MULTINOMIAL
+};
+
+// Options for runSimulations. The thread count never changes the generated
+// rounds: a given seed and engine produce the same book on any machine.
+struct SimulationOptions
+{
+	size_t			threads;	// 0 = one per hardware thread
+	RngEngine		engine;
+	GenerationMode	generation;
+	bool			shuffle;	// GENERATE_MULTINOMIAL: Fisher-Yates the rows
+	// Optional, shared with another thread: rounds generated so far are
+	// added to *progress; setting *cancel stops the run between blocks.
+	std::atomic<size_t>			*progress;
+	const std::atomic<bool>		*cancel;
+	// Optional: statistics of the blocks generated so far, updated per block
+	LiveStatistics				*live;
+	// Early stopping (GENERATE_ROUNDS, targetHalfWidth > 0): `count` becomes
+	// a cap, and the run keeps the shortest prefix of blocks whose RTP is
+	// known within +/- targetHalfWidth (0.0005 = 0.05%) at `confidence`.
+	double						targetHalfWidth;
+	double						confidence;
+
+	SimulationOptions(void);
+};
+
+// Exact distribution of a mode's paytable: a round pays payout_i (in
+// PAYOUT_SCALE units) with probability weight_i / totalWeight. The sums are
+// exact integers, so e.g. RTP = payoutSum / (totalWeight * PAYOUT_SCALE)
+// with no sampling error.
+struct ModeAnalysis
+{
+	uint64_t			totalWeight;
+	uint64_t			hitWeight;			// Weight of non-zero payouts
+	unsigned __int128	payoutSum;			// sum(weight_i * payout_i)
+	unsigned __int128	payoutSquareSum;	// sum(weight_i * payout_i^2)
+	uint64_t			minPayout;			// Of the rows that weigh
+	uint64_t			maxPayout;
+	ModeStatistics		stats;				// Exact values, count = 0
+
+	ModeAnalysis(void);
+
+	void	finish(void);
+};
+
+// Rows of the exported lookup table. The aggregated tables hold one book
+// per distinct payout, weighted by the paytable (LOOKUP_CONFIGURED) or by
+// how many simulated rounds landed on it (LOOKUP_OBSERVED).
+enum LookupTable
+{
+	LOOKUP_ROUNDS,		// One book of weight 1 per simulated round
+	LOOKUP_CONFIGURED,
+	LOOKUP_OBSERVED
+};
+
+// Options for exportAll.
+struct ExportOptions
+{
+	CompressionSettings	compression;	// For books_<mode>.jsonl.zst
+	// > 0: seekable books file, one zstd frame every booksPerFrame books,
+	// readable one book at a time with BookReader
+	size_t				booksPerFrame;
+	// > 0: train a zstd dictionary of up to this many bytes on a sample of
+	// the books, saved as books_<mode>.dict next to index.json
+	size_t				dictionarySize;
+	LookupTable			lookup;
+	size_t				csvThreads;		// Lookup table writers, 0 = all cores
+	bool				preallocate;	// fallocate lookup tables up front
+	size_t				threads;		// Files written at once, 0 = all cores
+	bool				verbose;		// Print the files written
+	// Optional, shared with another thread: books written so far are added
+	// to *progress; setting *cancel aborts the export (nothing is committed).
+	std::atomic<size_t>			*progress;
+	const std::atomic<bool>		*cancel;
+
+	ExportOptions(void);
+};
+
 struct GameMode
 {
 	std::string						name;
 	double							cost;
 	std::vector<MultiplierConfig>	multipliers;
-	std::vector<Simulation>			simulations;
+	SimulationStore					simulations;
+	PayoutMoments					moments;		// Of simulations
+	ModeStatistics					stats;			// From moments
 	uint64_t						totalWeight;
+	AliasTable						sampler;		// Built from multipliers
+	bool							samplerReady;	// Cleared by addMultiplier
 };
 
 class Distribution
 {
 	public:
+		static constexpr size_t	BLOCK_SIZE = 65536;	// Rounds per RNG stream
+		// Blocks alive at once in streamSimulations, whatever the producers
+		static constexpr size_t	STREAM_RING_BLOCKS = 4;
+		static constexpr size_t	MAX_ROUND_EVENTS = 2;
+		// Books per training sample when the books are a single frame
+		static constexpr size_t	DICTIONARY_SAMPLE_BOOKS = 256;
+
 		Distribution(void);
 		~Distribution(void);
 
 		void		addMode(const std::string &name, double cost);
 		void		addMultiplier(const std::string &mode,
 						double multiplier, uint64_t weight);
-		void		runSimulations(const std::string &mode,
-						size_t count, uint64_t seed);
+		bool		runSimulations(const std::string &mode,
+						size_t count, uint64_t seed,
+						const SimulationOptions &options
+						= SimulationOptions());
+		bool		replaySimulation(const std::string &mode, uint64_t id,
+						uint64_t seed, const SimulationOptions &options,
+						Simulation &sim) const;
+		bool		samplePayouts(const std::string &mode, uint64_t seed,
+						RngEngine engine, std::vector<uint64_t> &payouts);
 
 		size_t		modeCount(void) const;
 		size_t		simulationCount(const std::string &mode) const;
 		double		getRTP(const std::string &mode) const;
+		const ModeStatistics	&getStatistics(const std::string &mode) const;
+		double		getRTPHalfWidth(const std::string &mode,
+						double confidence) const;
+		ModeAnalysis	analyzeMode(const std::string &mode) const;
+		const std::vector<MultiplierConfig>	&getMultipliers(
+						const std::string &mode) const;
+		const SimulationStore	&getSimulations(const std::string &mode) const;
+		static ModeAnalysis	analyzeRows(
+						const std::vector<MultiplierConfig> &rows,
+						const ModeAnalysis &base = ModeAnalysis());
+		template <class Rng>
+		static void	multinomialCounts(
+						const std::vector<MultiplierConfig> &rows,
+						size_t count, Rng &rng, std::vector<uint64_t> &ends);
+		static uint64_t	payoutUnits(double multiplier);
+		bool		solveWeights(const std::string &mode,
+						const SolverTargets &targets, SolverResult &result);
+		bool		verifyRTP(const std::string &mode, double confidence,
+						std::string &error) const;
 
 		double		getMeanPayout(const std::string &mode) const;
 		double		getVariance(const std::string &mode) const;
@@ -69,20 +200,87 @@ class Distribution
 		double		getMinPayout(const std::string &mode) const;
 		double		getMaxPayout(const std::string &mode) const;
 
-		bool		exportAll(const std::string &outputDir) const;
+		bool		exportAll(const std::string &outputDir,
+						const ExportOptions &options = ExportOptions()) const;
+		bool		streamSimulations(const std::string &mode,
+						size_t count, uint64_t seed,
+						const std::string &outputDir,
+						const SimulationOptions &simulation,
+						const ExportOptions &exporting);
+		bool		exportIndex(const std::string &path) const;
 
 	private:
 		std::map<std::string, GameMode>	_modes;
 
-		uint64_t	pickMultiplier(const GameMode &mode,
-						std::mt19937_64 &rng) const;
+		// bench_main.cpp: forwards to the export stages below and nothing
+		// else, so they can be timed one by one
+		friend struct DistributionBench;
+
+		void		prepareSampler(GameMode &mode);
+		template <class Rng>
+		uint64_t	pickMultiplier(const GameMode &mode, Rng &rng) const;
+		template <class Emit>
+		void		drawRounds(const GameMode &mode, size_t first,
+						size_t last, uint64_t seed, RngEngine engine,
+						Emit emit) const;
+		static size_t	roundEvents(uint64_t payout, GameEvent *events);
+		static void	aggregateOutcomes(const GameMode &mode,
+						LookupTable lookup, SimulationStore &store);
+		static void	fillOutcomes(std::map<uint64_t, uint64_t> weights,
+						SimulationStore &store);
+		void		simulateBlock(const GameMode &mode,
+						SimulationStore &store, size_t base, size_t block,
+						uint64_t seed, RngEngine engine) const;
+		bool		simulateToPrecision(GameMode &mode, size_t count,
+						uint64_t seed, const SimulationOptions &options,
+						LiveStatistics &live, ThreadPool *pool) const;
+		template <class Rng>
+		bool		generateMultinomial(GameMode &mode, Rng &rng,
+						const SimulationOptions &options,
+						LiveStatistics &live, ThreadPool *pool) const;
+		void		emitBlockEvents(const GameMode &mode,
+						SimulationStore &store, size_t first,
+						size_t last) const;
+		static std::string	lookUpTablePath(const std::string &outputDir,
+						const GameMode &mode);
+		static std::string	booksPath(const std::string &outputDir,
+						const GameMode &mode);
+		static std::string	dictionaryPath(const std::string &outputDir,
+						const GameMode &mode);
+		bool		trainDictionary(const std::string &mode,
+						const SimulationStore &store, size_t capacity,
+						size_t sampleBooks, std::string &dictionary) const;
 		bool		exportCSV(const std::string &path,
-						const GameMode &mode) const;
+						const std::string &mode,
+						const SimulationStore &store,
+						const ExportOptions &options,
+						std::string &error) const;
 		bool		exportJSONLCompressed(const std::string &path,
-						const GameMode &mode) const;
-		bool		exportIndex(const std::string &path) const;
-		std::string	formatGameEvent(const GameEvent &event) const;
-		std::string	formatSimulation(const Simulation &sim) const;
+						const std::string &mode,
+						const SimulationStore &store,
+						const ExportOptions &options,
+						const std::string &dictionary,
+						std::string &error) const;
+		bool		exportBooks(const std::string &outputDir,
+						const GameMode &mode, const SimulationStore &store,
+						const ExportOptions &options, bool &trained,
+						std::string &error) const;
+		void		streamBlock(const GameMode &mode, StreamBlock &slot,
+						size_t count, uint64_t seed,
+						const SimulationOptions &simulation,
+						const ExportOptions &exporting,
+						LiveStatistics &live) const;
+		bool		streamBooks(BlockRing &ring, size_t blocks,
+						const std::string &outputDir, const GameMode &mode,
+						const ExportOptions &options, bool &trained,
+						std::string &error) const;
+		static bool	commitMode(const std::string &outputDir,
+						const GameMode &mode, bool trained,
+						std::string errors[2], bool verbose);
+		void		formatGameEvent(std::string &out,
+						const GameEvent &event) const;
+		void		formatSimulation(std::string &out,
+						const SimulationStore &store, size_t row) const;
 };
 
 #endif
@@ -0,0 +1,73 @@
+#ifndef GAMECONFIG_HPP
+# define GAMECONFIG_HPP
+
+# include <vector>
+# include <string>
+# include <cstdint>
+# include "Distribution.hpp"
+# include "Sweep.hpp"
+
+struct ModeConfig
+{
+	std::string						name;
+	double							cost;
+	std::vector<MultiplierConfig>	multipliers;	// payout is filled later
+	size_t							simulations;
+	uint64_t						seed;
+	bool							solve;			// Has a "solver" section
+	SolverTargets					solver;
+	double							verifyConfidence;	// 0 = no check
+};
+
+// One game as described by a JSON configuration file:
+//
+// {
+//   "name": "mygame",
+//   "output": "output/mygame",
+//   "simulations": 100000,
+//   "streaming": false,
+//   "simulation": { "engine": "philox", "generation": "rounds",
+//                   "targetHalfWidth": 0.0005, "confidence": 0.99 },
+//   "export": { "compression": "small", "lookup": "configured" },
+//   "modes": [
+//     { "name": "base", "cost": 1.0, "seed": 42,
+//       "multipliers": [[0.0, 350], [0.5, 250], [2.0, 80]],
+//       "solver": { "rtp": 0.96, "hitFrequency": 30, "volatility": 2.5,
+//                   "totalWeight": 1000000, "minWeight": 1, "fixed": [0],
+//                   "tolerance": 0.0001, "verifyConfidence": 0.9999 } }
+//   ],
+//   "sweep": { "mode": "base", "simulations": 1000000,
+//              "axes": [{ "row": 3, "field": "weight",
+//                         "from": 50, "to": 200, "step": 10 },
+//                       { "row": 4, "field": "multiplier",
+//                         "values": [2, 3, 5] }] }
+// }
+//
+// Only "modes" is required. A mode's "simulations" overrides the game's,
+// and its seed defaults to the game seed plus its index. A mode with a
+// "solver" has its weights solved before it is simulated, and its
+// simulated RTP checked against the exact one before export. "streaming"
+// exports each mode while it is simulated (Distribution::streamSimulations)
+// instead of simulating every mode and then exporting.
+struct GameConfig
+{
+	std::string				path;			// File it was read from
+	std::string				name;			// Default: file name
+	std::string				outputDir;		// Empty = chosen by the caller
+	std::vector<ModeConfig>	modes;
+	SimulationOptions		simulation;
+	ExportOptions			exporting;
+	bool					streaming;
+	SweepConfig				sweep;
+
+	GameConfig(void);
+
+	void	build(Distribution &dist) const;
+
+	static bool	load(const std::string &path, GameConfig &config,
+					std::string &error);
+	static bool	parse(const std::string &text, GameConfig &config,
+					std::string &error);
+};
+
+#endif
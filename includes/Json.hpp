@@ -0,0 +1,49 @@
+#ifndef JSON_HPP
+# define JSON_HPP
+
+# include <vector>
+# include <string>
+# include <utility>
+
+enum JsonType
+{
+	JSON_NULL,
+	JSON_BOOL,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT
+};
+
+// Minimal JSON document (RFC 8259) for configuration files. Numbers are
+// doubles, so integers are exact up to 2^53; object members keep their
+// order.
+class JsonValue
+{
+	public:
+		JsonValue(void);
+		~JsonValue(void);
+
+		JsonType						type(void) const;
+		bool							asBool(void) const;
+		double							asNumber(void) const;
+		const std::string				&asString(void) const;
+		const std::vector<JsonValue>	&asArray(void) const;
+		const JsonValue					*find(const std::string &key) const;
+
+		static bool						parse(const std::string &text,
+											JsonValue &value,
+											std::string &error);
+
+	private:
+		JsonType						_type;
+		bool							_bool;
+		double							_number;
+		std::string						_string;
+		std::vector<JsonValue>			_array;
+		std::vector<std::pair<std::string, JsonValue> >	_object;
+
+		friend class JsonParser;
+};
+
+#endif
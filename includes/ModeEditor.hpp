@@ -28,7 +28,6 @@ class ModeEditor
 		int					_numSimulations;
 		char				_outputDir[256];
 		bool				_exported;
-		bool				_isSimulating;
 		std::string			_statusMsg;
 
 		void				renderHeader(void);
@@ -37,6 +36,8 @@ class ModeEditor
 		void				renderSettings(void);
 		void				renderModesList(ModeManager &modeManager);
 		void				renderActions(ModeManager &modeManager);
+		void				renderJobProgress(ModeManager &modeManager);
+		void				pollJob(ModeManager &modeManager);
 		void				renderExportPreview(const ModeManager &modeManager);
 		void				renderStatus(void);
 };
@@ -3,6 +3,9 @@
 
 # include <vector>
 # include <string>
+# include <atomic>
+# include <memory>
+# include <thread>
 # include "Distribution.hpp"
 
 struct MultiplierEntry
@@ -32,8 +35,20 @@ struct ModeEntry
 	double						rtp;
 	size_t						simCount;
 	StatisticsCache				stats;
+	ModeStatistics				exact;		// Paytable ground truth
+	std::vector<ConvergencePoint>	convergence;	// RTP after each block
 };
 
+enum JobType
+{
+	JOB_NONE,
+	JOB_SIMULATE,
+	JOB_EXPORT
+};
+
+// Simulations and exports can run on a background thread (start*): the UI
+// thread polls progress every frame and takes the results over in
+// pollJob(). Modes must not be edited while a job is running.
 class ModeManager
 {
 	public:
@@ -45,14 +60,44 @@ class ModeManager
 		void						runAllSimulations(int numSimulations);
 		bool						exportFiles(const char *outputDir);
 
+		bool						startSimulations(int numSimulations);
+		bool						startExport(const char *outputDir);
+		void						cancelJob(void);
+		JobType						runningJob(void) const;
+		float						jobProgress(void) const;
+		JobType						pollJob(bool &succeeded);
+		bool						liveConvergence(size_t mode,
+										std::vector<ConvergencePoint> &points)
+										const;
+
 		std::vector<ModeEntry>&		getModes(void);
 		const std::vector<ModeEntry>&	getModes(void) const;
 		size_t						getModeCount(void) const;
 		const Distribution&			getDistribution(void) const;
 
+		static ModeAnalysis			analyze(const ModeEntry &mode);
+
 	private:
 		std::vector<ModeEntry>		_modes;
-		Distribution				_dist;
+		std::unique_ptr<Distribution>	_dist;
+
+		std::thread					_worker;
+		JobType						_job;
+		std::atomic<bool>			_jobDone;
+		bool						_jobOk;
+		std::atomic<size_t>			_progress;
+		size_t						_progressTotal;
+		std::atomic<bool>			_cancel;
+		std::unique_ptr<Distribution>	_pending;
+		std::vector<ModeEntry>		_pendingModes;
+		std::vector<std::unique_ptr<LiveStatistics> >	_live;
+
+		static bool					simulateModes(std::vector<ModeEntry> &modes,
+										Distribution &dist, int numSimulations,
+										SimulationOptions options,
+										const std::vector<std::unique_ptr<
+										LiveStatistics> > &live);
+		void						finishJob(void);
 };
 
 #endif
@@ -0,0 +1,137 @@
+#ifndef PROFILER_HPP
+# define PROFILER_HPP
+
+# include <vector>
+# include <string>
+# include <cstdint>
+# include <map>
+# include <mutex>
+# include <atomic>
+# include <chrono>
+# include <thread>
+# include <ostream>
+
+// Stages of the pipeline, timed separately for every mode.
+enum ProfilePhase
+{
+	PROFILE_SIMULATE,		// runSimulations, end to end
+	PROFILE_GENERATE,		// Drawing the rounds of a block
+	PROFILE_STATISTICS,		// Block moments and the statistics getters
+	PROFILE_EVENTS,			// Filling the events of a block
+	PROFILE_FORMAT,			// formatSimulation into the books buffer
+	PROFILE_COMPRESS,		// ZSTD_compressStream2
+	PROFILE_WRITE,			// Compressed bytes to disk
+	PROFILE_LOOKUP,			// Lookup table (CsvWriter formats and writes)
+	PROFILE_DICTIONARY,		// Sampling books and training a dictionary
+	PROFILE_PHASES
+};
+
+struct PhaseCounters
+{
+	uint64_t	calls;
+	uint64_t	nanoseconds;	// Summed over threads
+	uint64_t	bytes;			// Input of compress, output of the others
+
+	PhaseCounters(void);
+};
+
+struct ModeProfile
+{
+	std::string		name;
+	uint64_t		rounds;			// Simulated
+	uint64_t		firstNs;		// First traced span start
+	uint64_t		lastNs;			// Last traced span end
+	long			peakRssKb;		// Process peak when the mode last sampled
+	PhaseCounters	phases[PROFILE_PHASES];
+
+	ModeProfile(void);
+
+	double	wallSeconds(void) const;
+	double	roundsPerSecond(void) const;
+	uint64_t	bytesIn(void) const;		// Formatted books
+	uint64_t	bytesOut(void) const;		// Compressed books
+	double	compressionRatio(void) const;
+};
+
+// Process-wide timers and counters, off by default. While disabled a
+// ScopedTimer costs one atomic load; while enabled every timer adds to its
+// mode's counters under a mutex, and traced timers also keep a span (up to
+// MAX_SPANS) for writeTrace. Hot paths are timed per block or per buffer,
+// never per round.
+class Profiler
+{
+	public:
+		static const size_t	MAX_SPANS = 1 << 20;
+
+		static Profiler	&instance(void);
+
+		void		enable(bool enabled);
+		bool		enabled(void) const;
+		void		reset(void);
+		uint64_t	now(void) const;	// Nanoseconds since construction
+
+		void		record(const std::string &mode, ProfilePhase phase,
+						uint64_t start, uint64_t end, uint64_t bytes,
+						bool trace);
+		void		addRounds(const std::string &mode, uint64_t rounds);
+		void		sampleMemory(const std::string &mode);
+
+		std::vector<ModeProfile>	report(void) const;
+		void		printReport(std::ostream &out) const;
+		bool		writeTrace(const std::string &path,
+						std::string &error) const;
+
+		static const char	*phaseName(ProfilePhase phase);
+
+	private:
+		struct Span
+		{
+			uint32_t		mode;
+			uint32_t		thread;
+			ProfilePhase	phase;
+			uint64_t		start;
+			uint64_t		duration;
+			uint64_t		bytes;
+		};
+
+		mutable std::mutex						_mutex;
+		std::atomic<bool>						_enabled;
+		std::chrono::steady_clock::time_point	_epoch;
+		std::map<std::string, size_t>			_index;
+		std::vector<ModeProfile>				_modes;
+		std::map<std::thread::id, uint32_t>		_threads;
+		std::vector<Span>						_spans;
+		size_t									_dropped;
+
+		Profiler(void);
+		~Profiler(void);
+		Profiler(const Profiler &other);
+		Profiler	&operator=(const Profiler &other);
+
+		ModeProfile	&profile(const std::string &mode);
+};
+
+// Times its scope into Profiler::instance() under (mode, phase). An empty
+// mode disables it.
+class ScopedTimer
+{
+	public:
+		ScopedTimer(const std::string &mode, ProfilePhase phase,
+			bool trace = true);
+		~ScopedTimer(void);
+
+		void	addBytes(uint64_t bytes);
+
+	private:
+		const std::string	&_mode;
+		ProfilePhase		_phase;
+		bool				_trace;
+		bool				_active;
+		uint64_t			_start;
+		uint64_t			_bytes;
+
+		ScopedTimer(const ScopedTimer &other);
+		ScopedTimer	&operator=(const ScopedTimer &other);
+};
+
+#endif
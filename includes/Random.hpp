@@ -0,0 +1,222 @@
+#ifndef RANDOM_HPP
+# define RANDOM_HPP
+
+# include <cstdint>
+# include <string>
+# include <cmath>
+
+// SplitMix64 finalizer: a bijective 64-bit mix with good avalanche.
+inline uint64_t	splitMix64(uint64_t x)
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return (x ^ (x >> 31));
+}
+
+// Seed of an independent sub-stream, e.g. one per simulation block.
+inline uint64_t	streamSeed(uint64_t seed, uint64_t stream)
+{
+	return (splitMix64(seed ^ splitMix64(stream)));
+}
+
+// FNV-1a, used to fold names (e.g. a mode) into stream keys.
+inline uint64_t	hashString(const std::string &str)
+{
+	uint64_t	hash;
+
+	hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < str.size(); i++)
+	{
+		hash ^= static_cast<unsigned char>(str[i]);
+		hash *= 0x100000001B3ULL;
+	}
+	return (hash);
+}
+
+// Philox4x32-10 (Salmon et al., SC'11). Output is a pure function of
+// (key, counter): the stream for counter N can be produced directly,
+// without generating the streams before it.
+class PhiloxStream
+{
+	public:
+		typedef uint64_t	result_type;
+
+		PhiloxStream(uint64_t key, uint64_t counter);
+
+		static constexpr result_type	min(void) { return (0); }
+		static constexpr result_type	max(void) { return (UINT64_MAX); }
+		result_type						operator()(void);
+
+	private:
+		uint32_t	_key[2];
+		uint32_t	_counter[4];
+		uint32_t	_block[4];
+		int			_used;
+
+		void		generate(void);
+};
+
+inline PhiloxStream::PhiloxStream(uint64_t key, uint64_t counter)
+	: _used(4)
+{
+	_key[0] = static_cast<uint32_t>(key);
+	_key[1] = static_cast<uint32_t>(key >> 32);
+	_counter[0] = static_cast<uint32_t>(counter);
+	_counter[1] = static_cast<uint32_t>(counter >> 32);
+	_counter[2] = 0;
+	_counter[3] = 0;
+}
+
+inline void	PhiloxStream::generate(void)
+{
+	uint32_t	c[4];
+	uint32_t	k[2];
+	uint64_t	p0;
+	uint64_t	p1;
+
+	for (int i = 0; i < 4; i++)
+		c[i] = _counter[i];
+	k[0] = _key[0];
+	k[1] = _key[1];
+	for (int round = 0; round < 10; round++)
+	{
+		p0 = static_cast<uint64_t>(0xD2511F53U) * c[0];
+		p1 = static_cast<uint64_t>(0xCD9E8D57U) * c[2];
+		c[0] = static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0];
+		c[2] = static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1];
+		c[1] = static_cast<uint32_t>(p1);
+		c[3] = static_cast<uint32_t>(p0);
+		k[0] += 0x9E3779B9U;
+		k[1] += 0xBB67AE85U;
+	}
+	for (int i = 0; i < 4; i++)
+		_block[i] = c[i];
+	if (++_counter[2] == 0)
+		_counter[3]++;
+	_used = 0;
+}
+
+inline PhiloxStream::result_type	PhiloxStream::operator()(void)
+{
+	uint64_t	value;
+
+	if (_used >= 4)
+		generate();
+	value = (static_cast<uint64_t>(_block[_used + 1]) << 32) | _block[_used];
+	_used += 2;
+	return (value);
+}
+
+// Unbiased integer in [0, bound) from a 64-bit engine (Lemire's
+// multiply-shift with rejection). Unlike std::uniform_int_distribution the
+// mapping is fully specified, so a seed gives the same draws on every
+// standard library.
+template <class Rng>
+inline uint64_t	randomBelow(Rng &rng, uint64_t bound)
+{
+	unsigned __int128	product;
+	uint64_t			low;
+	uint64_t			threshold;
+
+	product = static_cast<unsigned __int128>(rng()) * bound;
+	low = static_cast<uint64_t>(product);
+	if (low < bound)
+	{
+		threshold = -bound % bound;
+		while (low < threshold)
+		{
+			product = static_cast<unsigned __int128>(rng()) * bound;
+			low = static_cast<uint64_t>(product);
+		}
+	}
+	return (static_cast<uint64_t>(product >> 64));
+}
+
+// Uniform double in (0, 1], 53 random bits.
+template <class Rng>
+inline double	randomUnit(Rng &rng)
+{
+	return (((rng() >> 11) + 1) * 0x1.0p-53);
+}
+
+// log(k!) - [(k + 1/2) log(k + 1) - (k + 1) + log(2 pi) / 2], the error of
+// Stirling's approximation, tabulated below 10.
+inline double	stirlingTail(double k)
+{
+	static const double	table[10] = {
+		0.08106146679532726, 0.04134069595540929, 0.02767792568499834,
+		0.02079067210376509, 0.01664469118982119, 0.01387612882307075,
+		0.01189670994589177, 0.01041126526197209, 0.009255462182712733,
+		0.008330563433362871
+	};
+	double				kp1sq;
+
+	if (k <= 9)
+		return (table[static_cast<int>(k)]);
+	kp1sq = (k + 1) * (k + 1);
+	return ((1.0 / 12 - (1.0 / 360 - 1.0 / 1260 / kp1sq) / kp1sq) / (k + 1));
+}
+
+// Binomial(n, p) draw. Inversion by geometric gaps when n * p is small,
+// otherwise Hormann's BTRS transformed rejection (1993), whose cost does not
+// depend on n. The algorithm is fixed, so a seed gives the same draws on
+// every standard library (up to libm rounding).
+template <class Rng>
+inline uint64_t	randomBinomial(Rng &rng, uint64_t n, double p)
+{
+	if (n == 0 || p <= 0.0)
+		return (0);
+	if (p >= 1.0)
+		return (n);
+	if (p > 0.5)
+		return (n - randomBinomial(rng, n, 1.0 - p));
+	if (n * p < 10.0)
+	{
+		double		logq = std::log1p(-p);
+		double		gaps = 0.0;
+		uint64_t	k = 0;
+
+		while (true)
+		{
+			gaps += std::ceil(std::log(randomUnit(rng)) / logq);
+			if (gaps > static_cast<double>(n))
+				return (k);
+			k++;
+		}
+	}
+	const double	nd = static_cast<double>(n);
+	const double	spq = std::sqrt(nd * p * (1.0 - p));
+	const double	b = 1.15 + 2.53 * spq;
+	const double	a = -0.0873 + 0.0248 * b + 0.01 * p;
+	const double	c = nd * p + 0.5;
+	const double	vr = 0.92 - 4.2 / b;
+	const double	r = p / (1.0 - p);
+	const double	alpha = (2.83 + 5.1 / b) * spq;
+	const double	m = std::floor((nd + 1) * p);
+	double			u;
+	double			v;
+	double			us;
+	double			k;
+
+	while (true)
+	{
+		u = randomUnit(rng) - 0.5;
+		v = randomUnit(rng);
+		us = 0.5 - std::fabs(u);
+		k = std::floor((2 * a / us + b) * u + c);
+		if (k < 0 || k > nd)
+			continue ;
+		if (us >= 0.07 && v <= vr)
+			return (static_cast<uint64_t>(k));
+		v = std::log(v * alpha / (a / (us * us) + b));
+		if (v <= (m + 0.5) * std::log((m + 1) / (r * (nd - m + 1)))
+			+ (nd + 1) * std::log((nd - m + 1) / (nd - k + 1))
+			+ (k + 0.5) * std::log(r * (nd - k + 1) / (k + 1))
+			+ stirlingTail(m) + stirlingTail(nd - m)
+			- stirlingTail(k) - stirlingTail(nd - k))
+			return (static_cast<uint64_t>(k));
+	}
+}
+
+#endif
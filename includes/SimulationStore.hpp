@@ -0,0 +1,73 @@
+#ifndef SIMULATIONSTORE_HPP
+# define SIMULATIONSTORE_HPP
+
+# include <vector>
+# include <cstdint>
+# include <cstddef>
+
+// Interned game event types (what used to be free-form strings).
+enum EventType : uint8_t
+{
+	EVENT_REVEAL,
+	EVENT_WIN_INFO,
+	EVENT_SET_WIN,
+	EVENT_FINAL_WIN
+};
+
+const char	*eventTypeName(EventType type);
+
+// Game event: what happens DURING a single game round (16 bytes, no heap)
+struct GameEvent
+{
+	double		multiplier;
+	int32_t		amount;
+	uint16_t	index;
+	EventType	type;
+
+	GameEvent(void);
+	GameEvent(int idx, EventType t, double mult, int amt);
+};
+
+// Columnar storage for simulated rounds: one contiguous array per field, and
+// every event of every round in a single arena. Events of row r live in
+// [eventBegin(r), eventEnd(r)).
+//
+// Filling happens in two passes so that both can run in parallel: rows and
+// their event counts first, then buildEventIndex(), then the events
+// themselves through eventSlot().
+class SimulationStore
+{
+	public:
+		SimulationStore(void);
+		~SimulationStore(void);
+
+		void							clear(void);
+		void							resize(size_t rows);
+		size_t							size(void) const;
+		bool							empty(void) const;
+		size_t							memoryUsage(void) const;
+
+		void							setRow(size_t row, uint64_t id,
+											uint64_t weight, uint64_t payout);
+		void							swapOutcomes(size_t a, size_t b);
+		void							setEventCount(size_t row,
+											size_t count);
+		void							buildEventIndex(void);
+		GameEvent						*eventSlot(size_t row);
+
+		const std::vector<uint64_t>		&ids(void) const;
+		const std::vector<uint64_t>		&weights(void) const;
+		const std::vector<uint64_t>		&payouts(void) const;
+		const std::vector<GameEvent>	&events(void) const;
+		size_t							eventBegin(size_t row) const;
+		size_t							eventEnd(size_t row) const;
+
+	private:
+		std::vector<uint64_t>			_ids;
+		std::vector<uint64_t>			_weights;
+		std::vector<uint64_t>			_payouts;	// In PAYOUT_SCALE units
+		std::vector<uint64_t>			_eventOffsets;	// size() + 1 entries
+		std::vector<GameEvent>			_events;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef STATISTICS_HPP
+# define STATISTICS_HPP
+
+# include <cstdint>
+# include <cstddef>
+# include <mutex>
+# include <vector>
+# include "SimulationStore.hpp"
+
+// Payouts are integers in 1 / PAYOUT_SCALE of a multiplier: 150 = 1.5x.
+constexpr uint64_t	PAYOUT_SCALE = 100;
+
+// Every statistic of a mode's simulations. Payouts are multipliers
+// (1.5 = 1.5x).
+struct ModeStatistics
+{
+	size_t		count;
+	double		rtp;			// Weighted mean payout
+	double		meanPayout;
+	double		variance;
+	double		stdDeviation;
+	double		volatility;		// stdDeviation / meanPayout
+	double		hitFrequency;	// Percent of non-zero payouts
+	double		minPayout;
+	double		maxPayout;
+
+	ModeStatistics(void);
+};
+
+// Exact integer sums over a set of rounds, in PAYOUT_SCALE units. Sums of
+// disjoint sets merge by addition, so rows can be accumulated in any
+// grouping; conversion to double only happens in statistics().
+//
+// The histogram has power-of-two bins: bin 0 counts zero payouts, bin b
+// payouts in [2^(b-1), 2^b).
+struct PayoutMoments
+{
+	static const size_t	HISTOGRAM_BINS = 65;
+
+	uint64_t			count;
+	uint64_t			hits;				// Rows with a non-zero payout
+	uint64_t			minPayout;
+	uint64_t			maxPayout;
+	unsigned __int128	weightSum;
+	unsigned __int128	weightedSum;		// sum(weight * payout)
+	unsigned __int128	payoutSum;
+	unsigned __int128	payoutSquareSum;
+	uint64_t			histogram[HISTOGRAM_BINS];
+
+	PayoutMoments(void);
+
+	void			add(const SimulationStore &store, size_t first,
+						size_t last);
+	void			addRepeated(uint64_t payout, uint64_t rows);
+	void			merge(const PayoutMoments &other);
+	ModeStatistics	statistics(void) const;
+	double			rtpHalfWidth(double z) const;
+
+	static size_t	histogramBin(uint64_t payout);
+};
+
+// Standard normal quantile, e.g. normalQuantile(0.995) = 2.5758.
+double	normalQuantile(double p);
+
+// One point of an RTP convergence curve.
+struct ConvergencePoint
+{
+	uint64_t	count;
+	double		rtp;
+	double		halfWidth;	// Of the 95% confidence interval on rtp
+};
+
+// Moments of the longest contiguous prefix of blocks finished so far.
+// Workers report blocks in any order, but they are merged strictly in block
+// order, so every prefix (and the final result) is the same whatever the
+// scheduling. Safe to read from another thread while blocks come in.
+//
+// With a target, merging stops at the first prefix whose RTP half-width
+// z * sd / sqrt(n) is at most the target half-width. sd is at least the
+// paytable's exact one: a prefix that has not hit a rare payout yet has a
+// sample sd of 0, and would otherwise stop at once.
+class LiveStatistics
+{
+	public:
+		LiveStatistics(void);
+		~LiveStatistics(void);
+
+		void							reset(size_t blocks);
+		void							setTarget(double halfWidth,
+											double z, double minSd);
+		size_t							addBlock(size_t block,
+											const PayoutMoments &moments);
+		bool							targetReached(void) const;
+		size_t							prefixBlocks(void) const;
+		PayoutMoments					prefix(void) const;
+		std::vector<ConvergencePoint>	convergence(void) const;
+
+	private:
+		mutable std::mutex				_mutex;
+		std::vector<PayoutMoments>		_blocks;
+		std::vector<bool>				_ready;
+		size_t							_merged;
+		double							_targetHalfWidth;	// 0 = none
+		double							_targetZ;
+		double							_targetMinSd;
+		bool							_reached;
+		PayoutMoments					_prefix;
+		std::vector<ConvergencePoint>	_convergence;
+
+		LiveStatistics(const LiveStatistics &other);
+		LiveStatistics	&operator=(const LiveStatistics &other);
+};
+
+#endif
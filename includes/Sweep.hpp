@@ -0,0 +1,98 @@
+#ifndef SWEEP_HPP
+# define SWEEP_HPP
+
+# include <vector>
+# include <string>
+# include <cstdint>
+# include <ostream>
+# include "Distribution.hpp"
+
+enum SweepField
+{
+	SWEEP_WEIGHT,
+	SWEEP_MULTIPLIER
+};
+
+// Values taken by one field of one paytable row.
+struct SweepAxis
+{
+	size_t				row;
+	SweepField			field;
+	std::vector<double>	values;
+
+	static SweepAxis	range(size_t row, SweepField field, double first,
+							double last, double step);
+	static SweepAxis	grid(size_t row, SweepField field,
+							const std::vector<double> &values);
+};
+
+struct SweepOptions
+{
+	size_t		threads;		// 0 = one per hardware thread
+	uint64_t	simulations;	// Rounds per variant, 0 = analytic only
+	uint64_t	seed;
+
+	SweepOptions(void);
+};
+
+// A sweep over one mode of a game configuration.
+struct SweepConfig
+{
+	std::string				mode;		// Empty = no sweep
+	std::vector<SweepAxis>	axes;
+	SweepOptions			options;
+};
+
+// Metrics of one variant. `exact` comes from the paytable; `simulated`
+// (count = 0 unless SweepOptions::simulations is set) from a multinomial
+// draw of that many rounds, seeded by (seed, variant).
+struct SweepResult
+{
+	size_t			variant;
+	ModeStatistics	exact;
+	ModeStatistics	simulated;
+};
+
+// The cartesian product of the axes over a base paytable. Variant v takes
+// value (v / stride_a) % size_a on axis a, the first axis varying fastest.
+//
+// The sums of the rows no axis touches are computed once; a variant only
+// adds its touched rows to them, so its exact metrics cost O(axes), not
+// O(rows). Simulated metrics draw k binomials per variant (the counts of a
+// GENERATE_MULTINOMIAL run), whatever the number of rounds.
+class Sweep
+{
+	public:
+		explicit Sweep(const std::vector<MultiplierConfig> &rows);
+		~Sweep(void);
+
+		bool		addAxis(const SweepAxis &axis, std::string &error);
+		size_t		axisCount(void) const;
+		size_t		variantCount(void) const;
+		double		value(size_t variant, size_t axis) const;
+		void		variantRows(size_t variant,
+						std::vector<MultiplierConfig> &rows) const;
+		void		run(const SweepOptions &options,
+						std::vector<SweepResult> &results) const;
+
+		void		printTable(std::ostream &out,
+						const std::vector<SweepResult> &results) const;
+		bool		writeCSV(const std::string &path,
+						const std::vector<SweepResult> &results,
+						std::string &error) const;
+
+	private:
+		std::vector<MultiplierConfig>	_rows;
+		std::vector<SweepAxis>			_axes;
+		std::vector<size_t>				_touched;	// Rows some axis changes
+		ModeAnalysis					_fixed;		// Sums of the other rows
+
+		void		prepareFixed(void);
+		ModeStatistics	evaluate(size_t variant,
+						std::vector<MultiplierConfig> &touched) const;
+		ModeStatistics	simulate(size_t variant, const SweepOptions &options,
+						std::vector<MultiplierConfig> &rows) const;
+		std::string	axisName(size_t axis) const;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef THREADPOOL_HPP
+# define THREADPOOL_HPP
+
+# include <vector>
+# include <queue>
+# include <thread>
+# include <mutex>
+# include <condition_variable>
+# include <functional>
+# include <cstddef>
+
+// Fixed set of worker threads consuming a FIFO task queue.
+class ThreadPool
+{
+	public:
+		explicit ThreadPool(size_t threads);
+		~ThreadPool(void);
+
+		void			submit(const std::function<void(void)> &task);
+		void			wait(void);
+		size_t			size(void) const;
+
+		static size_t	resolveThreads(size_t requested);
+
+	private:
+		std::vector<std::thread>				_workers;
+		std::queue<std::function<void(void)> >	_tasks;
+		std::mutex								_mutex;
+		std::condition_variable					_taskReady;
+		std::condition_variable					_allDone;
+		size_t									_pending;
+		bool									_stopping;
+
+		ThreadPool(const ThreadPool &other);
+		ThreadPool	&operator=(const ThreadPool &other);
+
+		void			workerLoop(void);
+};
+
+#endif
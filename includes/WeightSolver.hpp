@@ -0,0 +1,77 @@
+#ifndef WEIGHTSOLVER_HPP
+# define WEIGHTSOLVER_HPP
+
+# include <vector>
+# include <string>
+# include <cstdint>
+# include "Statistics.hpp"
+
+struct MultiplierConfig;
+
+// What Distribution::solveWeights aims for. Multipliers never change, only
+// weights. A negative hitFrequency or volatility leaves it free.
+struct SolverTargets
+{
+	double				rtp;			// 0.96 = 96%
+	double				hitFrequency;	// Percent, as in ModeStatistics
+	double				volatility;		// stdDeviation / meanPayout
+	uint64_t			totalWeight;	// 0 = keep the current total
+	uint64_t			minWeight;		// For every row that is not fixed
+	std::vector<size_t>	fixedRows;		// Rows whose weight is kept
+	double				tolerance;		// Once integer, see checkTargets
+
+	SolverTargets(void);
+};
+
+struct SolverResult
+{
+	bool					solved;
+	std::vector<uint64_t>	weights;		// One per row
+	ModeStatistics			exact;			// Of the solved paytable
+	size_t					iterations;		// Newton steps
+	std::string				error;
+
+	SolverResult(void);
+};
+
+// Solves for the probabilities closest to the current ones (in chi-square
+// distance) that meet the targets. Every target is linear in the
+// probabilities p_i:
+//   sum p_i = 1, sum p_i x_i = rtp, sum_{x_i > 0} p_i = hit,
+//   sum p_i x_i^2 = rtp^2 (1 + volatility^2)
+// so the problem is a projection onto a polytope. Its dual has one
+// variable per target (at most four) and is solved by semi-smooth Newton;
+// rows at their minimum weight drop out of the Jacobian. The probabilities
+// are then rounded to integer weights and polished by greedy +/-1 moves.
+// Cost is O(rows) per step: milliseconds for any real paytable.
+class WeightSolver
+{
+	public:
+		WeightSolver(const std::vector<MultiplierConfig> &rows,
+			const SolverTargets &targets);
+		~WeightSolver(void);
+
+		bool	solve(SolverResult &result);
+
+	private:
+		static const size_t		MAX_TARGETS = 4;
+
+		const std::vector<MultiplierConfig>	&_rows;
+		const SolverTargets		&_targets;
+		std::vector<double>		_x;			// Multipliers
+		std::vector<bool>		_fixed;
+		std::vector<double>		_a[MAX_TARGETS];	// Constraint rows
+		double					_b[MAX_TARGETS];
+		size_t					_m;
+		double					_total;
+
+		void	buildConstraints(void);
+		bool	project(std::vector<double> &p, size_t &iterations);
+		void	roundWeights(const std::vector<double> &p,
+					std::vector<uint64_t> &weights) const;
+		double	targetError(const long double *sums) const;
+		bool	checkTargets(const ModeStatistics &exact,
+					std::string &error) const;
+};
+
+#endif
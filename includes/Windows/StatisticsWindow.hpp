@@ -18,6 +18,8 @@ class StatisticsWindow
 		void	renderStatsTable(const ModeEntry &mode);
 		void	renderDistributionChart(const ModeEntry &mode);
 		void	renderRTPBar(const ModeEntry &mode);
+		void	renderConvergence(const std::vector<ConvergencePoint> &points,
+					double exactRtp);
 		void	renderNoDataWarning(void);
 };
 
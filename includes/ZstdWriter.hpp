@@ -0,0 +1,85 @@
+#ifndef ZSTDWRITER_HPP
+# define ZSTDWRITER_HPP
+
+# include <vector>
+# include <string>
+# include <fstream>
+# include <cstdint>
+# include <zstd.h>
+
+// zstd settings for book files. The default reproduces the historical
+// single-threaded level 3 output.
+struct CompressionSettings
+{
+	int		level;
+	int		workers;		// ZSTD_c_nbWorkers, 0 = compress on the caller
+	bool	longDistance;	// Long-distance matching for repetitive books
+	int		windowLog;		// 0 = level default, max 27 for plain decoders
+
+	CompressionSettings(void);
+
+	static CompressionSettings	fast(void);
+	static CompressionSettings	small(void);
+
+	CompressionSettings	splitAcross(size_t writers) const;
+};
+
+// Streams bytes into a .zst file with constant memory: input is staged in a
+// fixed buffer, compressed with ZSTD_compressStream2, and the output buffer
+// is written to disk every time it fills.
+//
+// A seekable writer closes a frame at every endFrame() and ends the file
+// with a seek table in the zstd seekable format (contrib/seekable_format):
+// a skippable frame listing the compressed and decompressed size of every
+// frame. Plain decoders skip it and read the frames as one stream.
+//
+// With a dictionary, every frame is compressed against it: the dictionary
+// is digested once into a ZSTD_CDict that all frames of the file reference.
+class ZstdWriter
+{
+	public:
+		static const uint32_t	SKIPPABLE_MAGIC = 0x184D2A5E;
+		static const uint32_t	SEEKABLE_MAGIC = 0x8F92EAB1;
+		static const size_t		SEEK_FOOTER_SIZE = 9;
+		static const size_t		SEEK_ENTRY_SIZE = 8;	// No checksums
+		static const size_t		MAX_FRAMES = 0x8000000;
+
+		ZstdWriter(void);
+		~ZstdWriter(void);
+
+		bool				open(const std::string &path,
+								const CompressionSettings &settings,
+								const std::string &profile = std::string());
+		void				setSeekable(bool seekable);
+		bool				setDictionary(const std::string &dictionary);
+		bool				write(const char *data, size_t size);
+		bool				endFrame(void);
+		bool				close(void);
+		const std::string	&error(void) const;
+
+	private:
+		ZSTD_CCtx			*_cctx;
+		ZSTD_CDict			*_cdict;
+		int					_level;
+		std::ofstream		_file;
+		std::vector<char>	_in;
+		size_t				_inUsed;
+		std::vector<char>	_out;
+		std::string			_error;
+		std::string			_profile;	// Profiler mode, empty = untimed
+		bool				_seekable;
+		uint64_t			_frameIn;	// Bytes of the open frame
+		uint64_t			_frameOut;
+		std::vector<std::pair<uint32_t, uint32_t> >	_frames;	// Out, in
+
+		ZstdWriter(const ZstdWriter &other);
+		ZstdWriter	&operator=(const ZstdWriter &other);
+
+		void				release(void);
+		bool				setParameter(ZSTD_cParameter param, int value);
+		bool				compress(ZSTD_EndDirective directive);
+		bool				writeSeekTable(void);
+		bool				fail(const std::string &message);
+};
+
+#endif
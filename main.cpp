@@ -1,6 +1,15 @@
 #include "Distribution.hpp"
+#include "GameConfig.hpp"
+#include "BatchRunner.hpp"
+#include "ThreadPool.hpp"
+#include "Sweep.hpp"
+#include "Profiler.hpp"
+#include "BookReader.hpp"
 #include <iostream>
 #include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
 #include <sys/stat.h>
 #include <chrono>
 
@@ -9,17 +18,298 @@ static void	createOutputDir(const std::string &path)
 	mkdir(path.c_str(), 0755);
 }
 
+static int	usage(void)
+{
+	std::cerr << "Usage: math-engine [--profile] [--trace <file>]"
+			  << " [<command>]" << std::endl
+			  << "       math-engine run <config.json>" << std::endl
+			  << "       math-engine sweep <config.json>" << std::endl
+			  << "       math-engine book <books.jsonl.zst> <id>..."
+			  << std::endl
+			  << "       math-engine batch <dir> [--output <dir>]"
+			  << " [--threads <n>]" << std::endl;
+	return (1);
+}
+
 static void	printModeStats(const Distribution &dist, const std::string &mode)
 {
 	std::cout << "  " << mode << ": "
-			  << dist.simulationCount(mode) << " sims, RTP "
+			  << dist.getStatistics(mode).count << " sims, RTP "
 			  << std::fixed << std::setprecision(2)
-			  << (dist.getRTP(mode) * 100.0) << "%" << std::endl;
+			  << (dist.getRTP(mode) * 100.0) << "% +/- "
+			  << (dist.getRTPHalfWidth(mode, 0.99) * 100.0) << "% (exact "
+			  << (dist.analyzeMode(mode).stats.rtp * 100.0) << "%)"
+			  << std::endl;
+}
+
+static bool	solveMode(Distribution &dist, const ModeConfig &mode)
+{
+	SolverResult	result;
+
+	if (!dist.solveWeights(mode.name, mode.solver, result))
+	{
+		std::cerr << "Error: mode '" << mode.name << "': " << result.error
+				  << std::endl;
+		return (false);
+	}
+	std::cout << "  " << mode.name << ": weights solved in "
+			  << result.iterations << " steps, RTP " << std::fixed
+			  << std::setprecision(4) << (result.exact.rtp * 100.0)
+			  << "%, hit " << result.exact.hitFrequency << "%, volatility "
+			  << result.exact.volatility << std::endl;
+	return (true);
+}
+
+// Streaming runs: each mode is simulated and exported in one pass, then
+// checked. Any earlier index.json is removed first and only written again
+// once every mode passed, so a failed run never looks complete.
+static int	streamConfig(const GameConfig &config, Distribution &dist,
+		const std::string &outputDir)
+{
+	std::string	error;
+
+	std::remove((outputDir + "/index.json").c_str());
+	std::cout << "Streaming to " << outputDir << "..." << std::endl;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t m = 0; m < config.modes.size(); m++)
+	{
+		if (!dist.streamSimulations(config.modes[m].name,
+				config.modes[m].simulations, config.modes[m].seed, outputDir,
+				config.simulation, config.exporting))
+			return (1);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	std::cout << "Done in " << std::chrono::duration_cast
+		<std::chrono::milliseconds>(end - start).count() << "ms"
+		<< std::endl << std::endl;
+
+	std::cout << "=== Results ===" << std::endl;
+	for (size_t m = 0; m < config.modes.size(); m++)
+		printModeStats(dist, config.modes[m].name);
+	std::cout << std::endl;
+	for (size_t m = 0; m < config.modes.size(); m++)
+	{
+		if (config.modes[m].verifyConfidence > 0.0
+			&& !dist.verifyRTP(config.modes[m].name,
+				config.modes[m].verifyConfidence, error))
+		{
+			std::cerr << "Error: " << error << ", index.json not written"
+					  << std::endl;
+			return (1);
+		}
+	}
+	if (!dist.exportIndex(outputDir + "/index.json"))
+		return (1);
+	if (config.exporting.verbose)
+		std::cout << "  Index: " << outputDir << "/index.json" << std::endl;
+	return (0);
+}
+
+// Runs one game: its modes one after the other, each on every core. Modes
+// with a solver get their weights first and must pass verifyRTP before
+// anything is exported.
+static int	runConfig(const std::string &path)
+{
+	GameConfig		config;
+	Distribution	dist;
+	std::string		error;
+	std::string		outputDir;
+
+	if (!GameConfig::load(path, config, error))
+	{
+		std::cerr << "Error: " << error << std::endl;
+		return (1);
+	}
+	outputDir = config.outputDir.empty() ? "output" : config.outputDir;
+	if (!BatchRunner::createDirectories(outputDir))
+	{
+		std::cerr << "Error: cannot create " << outputDir << std::endl;
+		return (1);
+	}
+	config.build(dist);
+	std::cout << "Running game '" << config.name << "' ("
+			  << config.modes.size() << " modes)..." << std::endl;
+	for (size_t m = 0; m < config.modes.size(); m++)
+	{
+		if (config.modes[m].solve && !solveMode(dist, config.modes[m]))
+			return (1);
+	}
+	if (config.streaming)
+		return (streamConfig(config, dist, outputDir));
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t m = 0; m < config.modes.size(); m++)
+	{
+		if (!dist.runSimulations(config.modes[m].name,
+				config.modes[m].simulations, config.modes[m].seed,
+				config.simulation))
+			return (1);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	std::cout << "Done in " << std::chrono::duration_cast
+		<std::chrono::milliseconds>(end - start).count() << "ms"
+		<< std::endl << std::endl;
+
+	std::cout << "=== Results ===" << std::endl;
+	for (size_t m = 0; m < config.modes.size(); m++)
+		printModeStats(dist, config.modes[m].name);
+	std::cout << std::endl;
+	for (size_t m = 0; m < config.modes.size(); m++)
+	{
+		if (config.modes[m].verifyConfidence > 0.0
+			&& !dist.verifyRTP(config.modes[m].name,
+				config.modes[m].verifyConfidence, error))
+		{
+			std::cerr << "Error: " << error << ", not exporting" << std::endl;
+			return (1);
+		}
+	}
+
+	std::cout << "Exporting files..." << std::endl;
+	if (!dist.exportAll(outputDir, config.exporting))
+		return (1);
+	return (0);
+}
+
+// Evaluates every variant of the configuration's "sweep" and writes them to
+// <output>/sweep_<mode>.csv. Small sweeps are also printed.
+static int	runSweep(const std::string &path)
+{
+	static const size_t			MAX_PRINTED = 100;
+	GameConfig					config;
+	Distribution				dist;
+	std::vector<SweepResult>	results;
+	std::string					error;
+	std::string					outputDir;
+	std::string					csvPath;
+
+	if (!GameConfig::load(path, config, error))
+	{
+		std::cerr << "Error: " << error << std::endl;
+		return (1);
+	}
+	if (config.sweep.mode.empty())
+	{
+		std::cerr << "Error: " << path << ": no \"sweep\" section" << std::endl;
+		return (1);
+	}
+	config.build(dist);
+	if (dist.getMultipliers(config.sweep.mode).empty())
+	{
+		std::cerr << "Error: " << path << ": sweep.mode: unknown mode '"
+				  << config.sweep.mode << "'" << std::endl;
+		return (1);
+	}
+	Sweep	sweep(dist.getMultipliers(config.sweep.mode));
+
+	for (size_t a = 0; a < config.sweep.axes.size(); a++)
+	{
+		if (!sweep.addAxis(config.sweep.axes[a], error))
+		{
+			std::cerr << "Error: " << path << ": sweep.axes[" << a << "]: "
+					  << error << std::endl;
+			return (1);
+		}
+	}
+	std::cout << "Sweeping " << sweep.variantCount() << " variants of '"
+			  << config.sweep.mode << "'..." << std::endl;
+	auto start = std::chrono::high_resolution_clock::now();
+	sweep.run(config.sweep.options, results);
+	auto end = std::chrono::high_resolution_clock::now();
+	std::cout << "Done in " << std::chrono::duration_cast
+		<std::chrono::milliseconds>(end - start).count() << "ms"
+		<< std::endl << std::endl;
+	if (results.size() <= MAX_PRINTED)
+	{
+		sweep.printTable(std::cout, results);
+		std::cout << std::endl;
+	}
+	outputDir = config.outputDir.empty() ? "output" : config.outputDir;
+	csvPath = outputDir + "/sweep_" + config.sweep.mode + ".csv";
+	if (!BatchRunner::createDirectories(outputDir)
+		|| !sweep.writeCSV(csvPath, results, error))
+	{
+		std::cerr << "Error: " << (error.empty() ? "cannot create "
+			+ outputDir : error) << std::endl;
+		return (1);
+	}
+	std::cout << "  Sweep: " << csvPath << std::endl;
+	return (0);
+}
+
+// Every *.json of `dir` is a game, written to <output>/<game name> unless
+// its configuration sets "output".
+static int	runBatch(const std::string &dir, const std::string &outputDir,
+		size_t threads)
+{
+	BatchRunner					runner(threads);
+	std::vector<std::string>	paths;
+	std::string					error;
+	GameConfig					config;
+	bool						ok;
+
+	if (!BatchRunner::loadDirectory(dir, paths, error))
+	{
+		std::cerr << "Error: " << error << std::endl;
+		return (1);
+	}
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		if (!GameConfig::load(paths[i], config, error)
+			|| !runner.add(config, config.outputDir.empty()
+				? outputDir + "/" + config.name : config.outputDir, error))
+		{
+			std::cerr << "Error: " << error << std::endl;
+			runner.addFailure(paths[i], error);
+		}
+	}
+	std::cout << "Running " << paths.size() << " games on "
+			  << ThreadPool::resolveThreads(threads) << " threads..."
+			  << std::endl;
+	ok = runner.run();
+	std::cout << std::endl;
+	runner.printSummary(std::cout);
+	return (ok ? 0 : 1);
+}
+
+// Prints books of a seekable books file (export.booksPerFrame), with the
+// time each lookup took on stderr.
+static int	runBook(const char *path, char **ids, int count)
+{
+	BookReader	reader;
+	std::string	book;
+
+	auto start = std::chrono::steady_clock::now();
+	if (!reader.open(path))
+	{
+		std::cerr << "Error: " << reader.error() << std::endl;
+		return (1);
+	}
+	auto end = std::chrono::steady_clock::now();
+	std::cerr << "Opened " << path << ": " << reader.frameCount()
+			  << " frames of " << reader.booksPerFrame() << " books in "
+			  << std::chrono::duration_cast<std::chrono::microseconds>
+			  (end - start).count() << "us" << std::endl;
+	for (int i = 0; i < count; i++)
+	{
+		start = std::chrono::steady_clock::now();
+		if (!reader.read(strtoull(ids[i], NULL, 10), book))
+		{
+			std::cerr << "Error: " << reader.error() << std::endl;
+			return (1);
+		}
+		end = std::chrono::steady_clock::now();
+		std::cout << book << std::endl;
+		std::cerr << "  read in " << std::chrono::duration_cast
+			<std::chrono::microseconds>(end - start).count() << "us"
+			<< std::endl;
+	}
+	return (0);
 }
 
-int	main(void)
+static int	runDemo(void)
 {
 	Distribution	dist;
+	ExportOptions	exportOptions;
 	std::string		outputDir;
 	size_t			numSimulations;
 
@@ -65,7 +355,84 @@ int	main(void)
 
 	// Export
 	std::cout << "Exporting files..." << std::endl;
-	dist.exportAll(outputDir);
+	exportOptions.threads = 0;
+	if (!dist.exportAll(outputDir, exportOptions))
+		return (1);
 
 	return (0);
 }
+
+static int	runCommand(int argc, char **argv)
+{
+	std::string	outputDir;
+	size_t		threads;
+
+	if (argc == 1)
+		return (runDemo());
+	if (argc == 3 && strcmp(argv[1], "run") == 0)
+		return (runConfig(argv[2]));
+	if (argc == 3 && strcmp(argv[1], "sweep") == 0)
+		return (runSweep(argv[2]));
+	if (argc >= 4 && strcmp(argv[1], "book") == 0)
+		return (runBook(argv[2], argv + 3, argc - 3));
+	if (argc < 3 || strcmp(argv[1], "batch") != 0)
+		return (usage());
+	outputDir = "output";
+	threads = 0;
+	for (int i = 3; i < argc; i += 2)
+	{
+		if (i + 1 >= argc)
+			return (usage());
+		if (strcmp(argv[i], "--output") == 0)
+			outputDir = argv[i + 1];
+		else if (strcmp(argv[i], "--threads") == 0)
+			threads = static_cast<size_t>(strtoul(argv[i + 1], NULL, 10));
+		else
+			return (usage());
+	}
+	return (runBatch(argv[2], outputDir, threads));
+}
+
+// --profile prints a per-mode timing report once the command is done;
+// --trace also writes every timed span as Chrome trace JSON.
+int	main(int argc, char **argv)
+{
+	std::string	tracePath;
+	std::string	error;
+	bool		profile;
+	int			status;
+
+	profile = false;
+	while (argc > 1 && strncmp(argv[1], "--", 2) == 0)
+	{
+		if (strcmp(argv[1], "--profile") == 0)
+			profile = true;
+		else if (strcmp(argv[1], "--trace") == 0 && argc > 2)
+		{
+			tracePath = argv[2];
+			argv++;
+			argc--;
+		}
+		else
+			return (usage());
+		argv++;
+		argc--;
+	}
+	Profiler::instance().enable(profile || !tracePath.empty());
+	status = runCommand(argc, argv);
+	if (profile)
+	{
+		std::cout << std::endl;
+		Profiler::instance().printReport(std::cout);
+	}
+	if (!tracePath.empty())
+	{
+		if (!Profiler::instance().writeTrace(tracePath, error))
+		{
+			std::cerr << "Error: " << error << std::endl;
+			return (1);
+		}
+		std::cout << "  Trace: " << tracePath << std::endl;
+	}
+	return (status);
+}
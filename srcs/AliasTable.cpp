@@ -0,0 +1,77 @@
+#include "AliasTable.hpp"
+
+AliasTable::AliasTable(void)
+	: _totalWeight(0)
+{
+}
+
+AliasTable::~AliasTable(void)
+{
+}
+
+// Vose's construction in integer arithmetic: weights are scaled by the
+// number of columns so every column target is exactly totalWeight.
+void	AliasTable::build(const std::vector<uint64_t> &weights)
+{
+	std::vector<unsigned __int128>	scaled(weights.size());
+	std::vector<uint32_t>			small;
+	std::vector<uint32_t>			large;
+	unsigned __int128				target;
+	uint32_t						s;
+	uint32_t						l;
+
+	_threshold.assign(weights.size(), 0);
+	_alias.assign(weights.size(), 0);
+	_totalWeight = 0;
+	for (size_t i = 0; i < weights.size(); i++)
+		_totalWeight += weights[i];
+	if (_totalWeight == 0)
+	{
+		_threshold.clear();
+		_alias.clear();
+		return ;
+	}
+	target = _totalWeight;
+	for (size_t i = 0; i < weights.size(); i++)
+	{
+		scaled[i] = static_cast<unsigned __int128>(weights[i]) * weights.size();
+		if (scaled[i] < target)
+			small.push_back(static_cast<uint32_t>(i));
+		else
+			large.push_back(static_cast<uint32_t>(i));
+	}
+	while (!small.empty() && !large.empty())
+	{
+		s = small.back();
+		small.pop_back();
+		l = large.back();
+		_threshold[s] = static_cast<uint64_t>(scaled[s]);
+		_alias[s] = l;
+		scaled[l] -= target - scaled[s];
+		if (scaled[l] < target)
+		{
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+	for (size_t i = 0; i < large.size(); i++)
+	{
+		_threshold[large[i]] = _totalWeight;
+		_alias[large[i]] = large[i];
+	}
+	for (size_t i = 0; i < small.size(); i++)
+	{
+		_threshold[small[i]] = _totalWeight;
+		_alias[small[i]] = small[i];
+	}
+}
+
+size_t	AliasTable::size(void) const
+{
+	return (_threshold.size());
+}
+
+bool	AliasTable::empty(void) const
+{
+	return (_threshold.empty());
+}
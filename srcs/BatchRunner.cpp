@@ -0,0 +1,381 @@
+#include "BatchRunner.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// State of a game while its tasks are in flight.
+struct BatchGame
+{
+	std::unique_ptr<Distribution>	dist;
+	std::atomic<size_t>				remaining;	// Modes still simulating
+	std::atomic<bool>				failed;
+};
+
+static double	secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return (std::chrono::duration<double>(std::chrono::steady_clock::now()
+		- start).count());
+}
+
+// A game's export options inside a batch: one file at a time, compressed
+// on the task's own thread.
+static ExportOptions	batchExportOptions(const GameConfig &config)
+{
+	ExportOptions	options;
+
+	options = config.exporting;
+	options.threads = 1;
+	options.csvThreads = 1;
+	options.compression.workers = 0;
+	options.verbose = false;
+	options.progress = NULL;
+	options.cancel = NULL;
+	return (options);
+}
+
+BatchRunner::BatchRunner(size_t threads)
+	: _threads(threads), _seconds(0.0)
+{
+}
+
+BatchRunner::~BatchRunner(void)
+{
+}
+
+// Games write to distinct directories; a second game with the same output
+// directory is refused.
+bool	BatchRunner::add(const GameConfig &config,
+		const std::string &outputDir, std::string &error)
+{
+	BatchGameResult	result;
+
+	for (size_t g = 0; g < _results.size(); g++)
+	{
+		if (_results[g].error.empty() && _results[g].outputDir == outputDir)
+		{
+			error = config.path + ": output directory " + outputDir
+				+ " already used by " + _configs[g].path;
+			return (false);
+		}
+	}
+	result.name = config.name;
+	result.outputDir = outputDir;
+	result.exportSeconds = 0.0;
+	result.modes.resize(config.modes.size());
+	for (size_t m = 0; m < config.modes.size(); m++)
+	{
+		result.modes[m].game = config.name;
+		result.modes[m].mode = config.modes[m].name;
+		result.modes[m].simulations = 0;
+		result.modes[m].rtp = 0.0;
+		result.modes[m].halfWidth = 0.0;
+		result.modes[m].exactRtp = 0.0;
+		result.modes[m].seconds = 0.0;
+		result.modes[m].ok = false;
+	}
+	_configs.push_back(config);
+	_results.push_back(result);
+	return (true);
+}
+
+// Records a game that could not be loaded, so it shows in the summary.
+void	BatchRunner::addFailure(const std::string &name,
+		const std::string &error)
+{
+	BatchGameResult	result;
+
+	result.name = name;
+	result.exportSeconds = 0.0;
+	result.error = error;
+	_configs.push_back(GameConfig());
+	_results.push_back(result);
+}
+
+// Returns true when every game was simulated and exported.
+bool	BatchRunner::run(void)
+{
+	std::chrono::steady_clock::time_point	start;
+	std::vector<std::unique_ptr<BatchGame> >	games;
+	ThreadPool								pool(_threads);
+	bool									ok;
+
+	start = std::chrono::steady_clock::now();
+
+	// Streaming games have written their modes already: only index.json
+	// is left
+	auto	exportGame = [&](size_t g) {
+		std::chrono::steady_clock::time_point	exportStart;
+		const std::string						&dir = _results[g].outputDir;
+
+		exportStart = std::chrono::steady_clock::now();
+		if (_configs[g].streaming)
+		{
+			if (!games[g]->dist->exportIndex(dir + "/index.json"))
+				_results[g].error = _results[g].name + ": export failed";
+		}
+		else if (!createDirectories(dir))
+			_results[g].error = _results[g].name + ": cannot create " + dir;
+		else if (!games[g]->dist->exportAll(dir,
+				batchExportOptions(_configs[g])))
+			_results[g].error = _results[g].name + ": export failed";
+		_results[g].exportSeconds = secondsSince(exportStart);
+		games[g]->dist.reset();
+	};
+
+	auto	simulateMode = [&](size_t g, size_t m) {
+		std::chrono::steady_clock::time_point	modeStart;
+		const ModeConfig						&mode = _configs[g].modes[m];
+		BatchModeResult							&result = _results[g].modes[m];
+		SimulationOptions						options;
+		Distribution							&dist = *games[g]->dist;
+
+		modeStart = std::chrono::steady_clock::now();
+		options = _configs[g].simulation;
+		options.threads = 1;
+		options.progress = NULL;
+		options.cancel = NULL;
+		options.live = NULL;
+		result.ok = true;
+		if (mode.solve)
+		{
+			SolverResult	solved;
+
+			result.ok = dist.solveWeights(mode.name, mode.solver, solved);
+			result.error = solved.error;
+		}
+		if (result.ok && _configs[g].streaming)
+		{
+			if (!dist.streamSimulations(mode.name, mode.simulations,
+					mode.seed, _results[g].outputDir, options,
+					batchExportOptions(_configs[g])))
+			{
+				result.ok = false;
+				result.error = "streaming failed";
+			}
+		}
+		else if (result.ok && !dist.runSimulations(mode.name,
+				mode.simulations, mode.seed, options))
+		{
+			result.ok = false;
+			result.error = "simulation failed";
+		}
+		if (result.ok && mode.verifyConfidence > 0.0)
+			result.ok = dist.verifyRTP(mode.name, mode.verifyConfidence,
+				result.error);
+		result.seconds = secondsSince(modeStart);
+		if (result.ok)
+		{
+			result.simulations = dist.getStatistics(mode.name).count;
+			result.rtp = dist.getRTP(mode.name);
+			result.halfWidth = dist.getRTPHalfWidth(mode.name, 0.99);
+			result.exactRtp = dist.analyzeMode(mode.name).stats.rtp;
+		}
+		else
+			games[g]->failed = true;
+		if (--games[g]->remaining > 0)
+			return ;
+		if (games[g]->failed)
+		{
+			for (size_t i = 0; i < _results[g].modes.size(); i++)
+			{
+				if (!_results[g].modes[i].ok)
+				{
+					_results[g].error = _results[g].name + ": mode '"
+						+ _results[g].modes[i].mode + "': "
+						+ _results[g].modes[i].error;
+					break ;
+				}
+			}
+			games[g]->dist.reset();
+		}
+		else
+			pool.submit([&exportGame, g]() { exportGame(g); });
+	};
+
+	// A streaming game writes its modes as they run, and only gets an
+	// index.json once all of them passed
+	for (size_t g = 0; g < _configs.size(); g++)
+	{
+		games.push_back(std::unique_ptr<BatchGame>(new BatchGame()));
+		games[g]->remaining = _configs[g].modes.size();
+		games[g]->failed = false;
+		if (_results[g].error.empty() && _configs[g].streaming)
+		{
+			if (!createDirectories(_results[g].outputDir))
+				_results[g].error = _results[g].name + ": cannot create "
+					+ _results[g].outputDir;
+			std::remove((_results[g].outputDir + "/index.json").c_str());
+		}
+		if (!_results[g].error.empty())
+			continue ;
+		games[g]->dist.reset(new Distribution());
+		_configs[g].build(*games[g]->dist);
+	}
+	for (size_t g = 0; g < _configs.size(); g++)
+	{
+		if (!_results[g].error.empty())
+			continue ;
+		for (size_t m = 0; m < _configs[g].modes.size(); m++)
+			pool.submit([&simulateMode, g, m]() { simulateMode(g, m); });
+	}
+	pool.wait();
+	_seconds = secondsSince(start);
+	ok = true;
+	for (size_t g = 0; g < _results.size(); g++)
+		ok = ok && _results[g].error.empty();
+	return (ok);
+}
+
+const std::vector<BatchGameResult>	&BatchRunner::results(void) const
+{
+	return (_results);
+}
+
+// One line per mode, then one per failed game with its error.
+void	BatchRunner::printSummary(std::ostream &out) const
+{
+	size_t	nameWidth;
+	size_t	modeWidth;
+	size_t	failed;
+
+	nameWidth = 4;
+	modeWidth = 4;
+	for (size_t g = 0; g < _results.size(); g++)
+	{
+		if (!_results[g].modes.empty())
+			nameWidth = std::max(nameWidth, _results[g].name.size());
+		for (size_t m = 0; m < _results[g].modes.size(); m++)
+			modeWidth = std::max(modeWidth, _results[g].modes[m].mode.size());
+	}
+	out << std::left << std::setw(nameWidth) << "Game" << "  "
+		<< std::setw(modeWidth) << "Mode" << std::right
+		<< std::setw(12) << "Sims" << std::setw(10) << "RTP %"
+		<< std::setw(9) << "+/- %" << std::setw(10) << "Exact %"
+		<< std::setw(10) << "Time s" << "  Status" << std::endl;
+	out << std::fixed;
+	failed = 0;
+	for (size_t g = 0; g < _results.size(); g++)
+	{
+		const BatchGameResult	&game = _results[g];
+
+		failed += !game.error.empty();
+		for (size_t m = 0; m < game.modes.size(); m++)
+		{
+			const BatchModeResult	&mode = game.modes[m];
+
+			out << std::left << std::setw(nameWidth) << game.name << "  "
+				<< std::setw(modeWidth) << mode.mode << std::right
+				<< std::setw(12) << mode.simulations
+				<< std::setprecision(3)
+				<< std::setw(10) << mode.rtp * 100.0
+				<< std::setw(9) << mode.halfWidth * 100.0
+				<< std::setw(10) << mode.exactRtp * 100.0
+				<< std::setprecision(2)
+				<< std::setw(10) << mode.seconds << "  "
+				<< (!mode.ok ? "FAILED" : game.error.empty() ? "ok"
+					: "not exported") << std::endl;
+		}
+	}
+	for (size_t g = 0; g < _results.size(); g++)
+	{
+		if (!_results[g].error.empty())
+			out << "Error: " << _results[g].error << std::endl;
+	}
+	out << _results.size() << " games, " << failed << " failed, "
+		<< std::setprecision(2) << _seconds << "s" << std::endl;
+}
+
+// The *.json files of `dir`, sorted by name.
+bool	BatchRunner::loadDirectory(const std::string &dir,
+		std::vector<std::string> &paths, std::string &error)
+{
+	DIR				*handle;
+	struct dirent	*entry;
+	struct stat		info;
+	std::string		name;
+
+	handle = opendir(dir.c_str());
+	if (!handle)
+	{
+		error = dir + ": cannot open directory";
+		return (false);
+	}
+	paths.clear();
+	while ((entry = readdir(handle)) != NULL)
+	{
+		name = entry->d_name;
+		if (name.size() <= 5 || name.compare(name.size() - 5, 5, ".json") != 0)
+			continue ;
+		name = dir + "/" + name;
+		if (stat(name.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+			paths.push_back(name);
+	}
+	closedir(handle);
+	std::sort(paths.begin(), paths.end());
+	return (true);
+}
+
+// mkdir -p.
+bool	BatchRunner::createDirectories(const std::string &path)
+{
+	struct stat	info;
+	size_t		slash;
+
+	slash = 0;
+	while ((slash = path.find('/', slash + 1)) != std::string::npos)
+		mkdir(path.substr(0, slash).c_str(), 0755);
+	mkdir(path.c_str(), 0755);
+	return (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode));
+}
+
+// rm -r.
+bool	BatchRunner::removeDirectories(const std::string &path)
+{
+	DIR				*handle;
+	struct dirent	*entry;
+	struct stat		info;
+	std::string		name;
+	bool			ok;
+
+	if (lstat(path.c_str(), &info) != 0)
+		return (false);
+	if (!S_ISDIR(info.st_mode))
+		return (unlink(path.c_str()) == 0);
+	if (!(handle = opendir(path.c_str())))
+		return (false);
+	ok = true;
+	while ((entry = readdir(handle)) != NULL)
+	{
+		name = entry->d_name;
+		if (name != "." && name != "..")
+			ok = removeDirectories(path + "/" + name) && ok;
+	}
+	closedir(handle);
+	return (rmdir(path.c_str()) == 0 && ok);
+}
+
+// A new empty directory $TMPDIR/<prefix>.XXXXXX (default /tmp), for files
+// that must not land next to a real export.
+bool	BatchRunner::createScratchDirectory(const std::string &prefix,
+		std::string &path)
+{
+	const char			*tmp = std::getenv("TMPDIR");
+	std::vector<char>	name;
+
+	path = std::string(tmp && *tmp ? tmp : "/tmp") + "/" + prefix + ".XXXXXX";
+	name.assign(path.begin(), path.end());
+	name.push_back('\0');
+	if (!mkdtemp(name.data()))
+		return (false);
+	path = name.data();
+	return (true);
+}
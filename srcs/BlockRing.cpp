@@ -0,0 +1,91 @@
+#include "BlockRing.hpp"
+
+BlockRing::BlockRing(size_t capacity, size_t consumers)
+	: _slots(capacity > 0 ? capacity : 1), _consumers(consumers),
+	  _cancelled(false)
+{
+	for (size_t s = 0; s < _slots.size(); s++)
+	{
+		_slots[s].next = s;
+		_slots[s].pending = 0;
+		_slots[s].ready = false;
+	}
+}
+
+BlockRing::~BlockRing(void)
+{
+}
+
+StreamBlock	*BlockRing::reserve(size_t index)
+{
+	std::unique_lock<std::mutex>	lock(_mutex);
+	Slot							&slot = _slots[index % _slots.size()];
+
+	_changed.wait(lock, [&]() {
+		return (_cancelled || slot.next == index);
+	});
+	if (_cancelled)
+		return (NULL);
+	slot.block.index = index;
+	return (&slot.block);
+}
+
+void	BlockRing::publish(size_t index)
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	Slot						&slot = _slots[index % _slots.size()];
+
+	slot.ready = true;
+	slot.pending = _consumers;
+	if (_consumers == 0)
+		free(slot);
+	_changed.notify_all();
+}
+
+const StreamBlock	*BlockRing::acquire(size_t index)
+{
+	std::unique_lock<std::mutex>	lock(_mutex);
+	Slot							&slot = _slots[index % _slots.size()];
+
+	_changed.wait(lock, [&]() {
+		return (_cancelled || (slot.next == index && slot.ready));
+	});
+	if (_cancelled)
+		return (NULL);
+	return (&slot.block);
+}
+
+void	BlockRing::release(size_t index)
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	Slot						&slot = _slots[index % _slots.size()];
+
+	if (--slot.pending == 0)
+	{
+		free(slot);
+		_changed.notify_all();
+	}
+}
+
+// Wakes every waiting producer and consumer; they all get NULL.
+void	BlockRing::cancel(void)
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	_cancelled = true;
+	_changed.notify_all();
+}
+
+bool	BlockRing::cancelled(void) const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	return (_cancelled);
+}
+
+// Caller holds _mutex.
+void	BlockRing::free(Slot &slot)
+{
+	slot.ready = false;
+	slot.next += _slots.size();
+}
@@ -0,0 +1,260 @@
+#include "BookReader.hpp"
+#include "ZstdWriter.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+BookReader::BookReader(void)
+	: _fd(-1), _dctx(NULL), _ddict(NULL), _booksPerFrame(0),
+	  _cached(SIZE_MAX)
+{
+}
+
+BookReader::~BookReader(void)
+{
+	close();
+}
+
+static uint32_t	readLE32(const unsigned char *bytes)
+{
+	return (static_cast<uint32_t>(bytes[0])
+		| static_cast<uint32_t>(bytes[1]) << 8
+		| static_cast<uint32_t>(bytes[2]) << 16
+		| static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+// Full pread(), retrying on short reads and EINTR.
+static bool	readAll(int fd, void *data, size_t size, off_t offset)
+{
+	char	*cursor;
+	ssize_t	got;
+
+	cursor = static_cast<char *>(data);
+	while (size > 0)
+	{
+		got = pread(fd, cursor, size, offset);
+		if (got < 0 && errno == EINTR)
+			continue ;
+		if (got <= 0)
+			return (false);
+		cursor += got;
+		size -= got;
+		offset += got;
+	}
+	return (true);
+}
+
+bool	BookReader::open(const std::string &path,
+		const std::string &dictionary)
+{
+	close();
+	_error.clear();
+	_fd = ::open(path.c_str(), O_RDONLY);
+	if (_fd < 0)
+		return (fail("cannot open " + path));
+	_dctx = ZSTD_createDCtx();
+	if (!_dctx)
+		return (fail("cannot create ZSTD context"));
+	if (!readSeekTable() || !loadDictionary(path, dictionary)
+		|| !loadFrame(0))
+		return (false);
+	_booksPerFrame = _lines.size();
+	if (_booksPerFrame == 0 && _sizes.size() > 1)
+		return (fail(path + ": empty first frame"));
+	return (true);
+}
+
+void	BookReader::close(void)
+{
+	if (_fd >= 0)
+		::close(_fd);
+	if (_dctx)
+		ZSTD_freeDCtx(_dctx);
+	if (_ddict)
+		ZSTD_freeDDict(_ddict);
+	_fd = -1;
+	_dctx = NULL;
+	_ddict = NULL;
+	_offsets.clear();
+	_sizes.clear();
+	_booksPerFrame = 0;
+	_cached = SIZE_MAX;
+}
+
+// Footer (frame count, descriptor, magic) first, then the skippable frame
+// holding the entries. The compressed sizes must tile the file up to it.
+bool	BookReader::readSeekTable(void)
+{
+	unsigned char				footer[ZstdWriter::SEEK_FOOTER_SIZE];
+	std::vector<unsigned char>	table;
+	off_t						end;
+	uint64_t					frames;
+	size_t						entrySize;
+	size_t						tableSize;
+
+	end = lseek(_fd, 0, SEEK_END);
+	if (end < static_cast<off_t>(8 + sizeof(footer))
+		|| !readAll(_fd, footer, sizeof(footer), end - sizeof(footer))
+		|| readLE32(footer + 5) != ZstdWriter::SEEKABLE_MAGIC)
+		return (fail("not a seekable zstd file"));
+	if (footer[4] & 0x7C)
+		return (fail("unsupported seek table descriptor"));
+	entrySize = ZstdWriter::SEEK_ENTRY_SIZE + ((footer[4] & 0x80) ? 4 : 0);
+	frames = readLE32(footer);
+	tableSize = frames * entrySize + sizeof(footer);
+	if (frames == 0 || frames > ZstdWriter::MAX_FRAMES
+		|| static_cast<off_t>(tableSize + 8) > end)
+		return (fail("corrupt seek table"));
+	table.resize(tableSize + 8);
+	if (!readAll(_fd, table.data(), table.size(), end - table.size()))
+		return (fail("read failed"));
+	if (readLE32(table.data()) != ZstdWriter::SKIPPABLE_MAGIC
+		|| readLE32(table.data() + 4) != tableSize)
+		return (fail("corrupt seek table"));
+	_offsets.assign(1, 0);
+	_sizes.clear();
+	for (uint64_t f = 0; f < frames; f++)
+	{
+		const unsigned char	*entry = table.data() + 8 + f * entrySize;
+
+		_offsets.push_back(_offsets.back() + readLE32(entry));
+		_sizes.push_back(readLE32(entry + 4));
+	}
+	if (_offsets.back() != static_cast<uint64_t>(end) - table.size())
+		return (fail("corrupt seek table"));
+	return (true);
+}
+
+// Only when the first frame names a dictionary id; the dictionary must
+// carry the same id.
+bool	BookReader::loadDictionary(const std::string &path,
+		const std::string &dictionary)
+{
+	static const std::string	SUFFIX = ".jsonl.zst";
+	unsigned char				header[18];		// Largest frame header
+	std::ostringstream			content;
+	std::string					bytes;
+	std::string					dictPath;
+	size_t						size;
+	unsigned					id;
+
+	size = std::min<uint64_t>(sizeof(header), _offsets[1]);
+	if (!readAll(_fd, header, size, 0))
+		return (fail("read failed"));
+	id = ZSTD_getDictID_fromFrame(header, size);
+	if (id == 0)
+		return (true);
+	dictPath = dictionary;
+	if (dictPath.empty() && path.size() > SUFFIX.size()
+		&& path.compare(path.size() - SUFFIX.size(), SUFFIX.size(),
+			SUFFIX) == 0)
+		dictPath = path.substr(0, path.size() - SUFFIX.size()) + ".dict";
+	else if (dictPath.empty())
+		dictPath = path + ".dict";
+
+	std::ifstream	file(dictPath, std::ios::binary);
+
+	if (!file.is_open())
+		return (fail(path + " needs dictionary " + std::to_string(id)
+			+ ", cannot open " + dictPath));
+	content << file.rdbuf();
+	bytes = content.str();
+	_ddict = ZSTD_createDDict(bytes.data(), bytes.size());
+	if (!_ddict || ZSTD_getDictID_fromDDict(_ddict) != id)
+		return (fail(dictPath + " is not dictionary " + std::to_string(id)));
+	return (true);
+}
+
+bool	BookReader::loadFrame(size_t frame)
+{
+	size_t	size;
+	size_t	ret;
+
+	if (_cached == frame)
+		return (true);
+	_cached = SIZE_MAX;
+	size = _offsets[frame + 1] - _offsets[frame];
+	_compressed.resize(size);
+	if (!readAll(_fd, _compressed.data(), size, _offsets[frame]))
+		return (fail("read failed"));
+	_frame.resize(_sizes[frame]);
+	if (_ddict)
+		ret = ZSTD_decompress_usingDDict(_dctx, _frame.data(),
+			_frame.size(), _compressed.data(), size, _ddict);
+	else
+		ret = ZSTD_decompressDCtx(_dctx, _frame.data(), _frame.size(),
+			_compressed.data(), size);
+	if (ZSTD_isError(ret))
+		return (fail(std::string("ZSTD decompression failed: ")
+			+ ZSTD_getErrorName(ret)));
+	if (ret != _frame.size())
+		return (fail("corrupt seek table"));
+	_lines.clear();
+	for (size_t start = 0; start < _frame.size(); )
+	{
+		const char	*newline = static_cast<const char *>(memchr(
+			_frame.data() + start, '\n', _frame.size() - start));
+
+		_lines.push_back(start);
+		start = newline ? newline - _frame.data() + 1 : _frame.size();
+	}
+	_cached = frame;
+	return (true);
+}
+
+// Copies book `id` (its JSON line, without the newline) into `book`.
+bool	BookReader::read(uint64_t id, std::string &book)
+{
+	std::string	prefix;
+	size_t		frame;
+	size_t		row;
+	size_t		begin;
+	size_t		end;
+
+	if (_fd < 0)
+		return (fail("no books file open"));
+	if (id == 0 || _booksPerFrame == 0
+		|| (id - 1) / _booksPerFrame >= _sizes.size())
+		return (fail("book " + std::to_string(id) + " out of range"));
+	frame = (id - 1) / _booksPerFrame;
+	row = (id - 1) % _booksPerFrame;
+	if (!loadFrame(frame))
+		return (false);
+	if (row >= _lines.size())
+		return (fail("book " + std::to_string(id) + " out of range"));
+	begin = _lines[row];
+	end = row + 1 < _lines.size() ? _lines[row + 1] : _frame.size();
+	if (end > begin && _frame[end - 1] == '\n')
+		end--;
+	book.assign(_frame.data() + begin, end - begin);
+	prefix = "{\"id\":" + std::to_string(id) + ",";
+	if (book.compare(0, prefix.size(), prefix) != 0)
+		return (fail("book " + std::to_string(id)
+			+ " not found where expected (ids are not row + 1)"));
+	return (true);
+}
+
+size_t	BookReader::frameCount(void) const
+{
+	return (_sizes.size());
+}
+
+uint64_t	BookReader::booksPerFrame(void) const
+{
+	return (_booksPerFrame);
+}
+
+const std::string	&BookReader::error(void) const
+{
+	return (_error);
+}
+
+bool	BookReader::fail(const std::string &message)
+{
+	_error = message;
+	return (false);
+}
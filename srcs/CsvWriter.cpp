@@ -0,0 +1,201 @@
+#include "CsvWriter.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+CsvWriter::CsvWriter(void)
+{
+}
+
+CsvWriter::~CsvWriter(void)
+{
+}
+
+static size_t	decimalLength(uint64_t value)
+{
+	size_t	length;
+
+	length = 1;
+	while (value >= 10)
+	{
+		value /= 10;
+		length++;
+	}
+	return (length);
+}
+
+// Exact byte size of rows [first, last) once formatted.
+size_t	CsvWriter::rowsSize(const SimulationStore &store, size_t first,
+		size_t last)
+{
+	size_t	size;
+
+	size = 0;
+	for (size_t i = first; i < last; i++)
+	{
+		size += decimalLength(store.ids()[i])
+			+ decimalLength(store.weights()[i])
+			+ decimalLength(store.payouts()[i]) + 3;
+	}
+	return (size);
+}
+
+// Full pwrite(), retrying on short writes and EINTR.
+static bool	writeAll(int fd, const char *data, size_t size, off_t offset)
+{
+	ssize_t	written;
+
+	while (size > 0)
+	{
+		written = pwrite(fd, data, size, offset);
+		if (written < 0 && errno == EINTR)
+			continue ;
+		if (written <= 0)
+			return (false);
+		data += written;
+		size -= written;
+		offset += written;
+	}
+	return (true);
+}
+
+// Formats rows [first, last) and writes them from `offset` on.
+bool	CsvWriter::writeRows(int fd, const SimulationStore &store,
+		size_t first, size_t last, off_t offset, std::vector<char> &buffer)
+{
+	char	*cursor;
+	char	*end;
+	char	*flushAt;
+
+	buffer.resize(BUFFER_SIZE);
+	cursor = buffer.data();
+	end = buffer.data() + buffer.size();
+	flushAt = end - 3 * 20 - 3;
+	for (size_t i = first; i < last; i++)
+	{
+		cursor = std::to_chars(cursor, end, store.ids()[i]).ptr;
+		*cursor++ = ',';
+		cursor = std::to_chars(cursor, end, store.weights()[i]).ptr;
+		*cursor++ = ',';
+		cursor = std::to_chars(cursor, end, store.payouts()[i]).ptr;
+		*cursor++ = '\n';
+		if (cursor >= flushAt)
+		{
+			if (!writeAll(fd, buffer.data(), cursor - buffer.data(), offset))
+				return (false);
+			offset += cursor - buffer.data();
+			cursor = buffer.data();
+		}
+	}
+	return (writeAll(fd, buffer.data(), cursor - buffer.data(), offset));
+}
+
+// Same rows as writeRows(), appended to `out`.
+void	CsvWriter::appendRows(std::string &out, const SimulationStore &store,
+		size_t first, size_t last)
+{
+	size_t	used;
+	char	*cursor;
+
+	used = out.size();
+	out.resize(used + rowsSize(store, first, last));
+	cursor = &out[0] + used;
+	for (size_t i = first; i < last; i++)
+	{
+		cursor = std::to_chars(cursor, cursor + 20, store.ids()[i]).ptr;
+		*cursor++ = ',';
+		cursor = std::to_chars(cursor, cursor + 20, store.weights()[i]).ptr;
+		*cursor++ = ',';
+		cursor = std::to_chars(cursor, cursor + 20, store.payouts()[i]).ptr;
+		*cursor++ = '\n';
+	}
+}
+
+bool	CsvWriter::write(const std::string &path, const SimulationStore &store,
+		size_t threads, bool preallocate)
+{
+	std::vector<size_t>	bounds;
+	std::vector<off_t>	offsets;
+	std::atomic<bool>	ok(true);
+	size_t				segments;
+	off_t				total;
+	int					fd;
+
+	_error.clear();
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return (fail("cannot open " + path));
+	threads = ThreadPool::resolveThreads(threads);
+	segments = 1;
+	if (threads > 1)
+		segments = std::max<size_t>(1, std::min(threads * 4,
+			store.size() / (64 * 1024)));
+	if (segments == 1 && !preallocate)
+	{
+		std::vector<char>	buffer;
+
+		ok = writeRows(fd, store, 0, store.size(), 0, buffer);
+		if (::close(fd) != 0 || !ok)
+			return (fail("write failed on " + path));
+		return (true);
+	}
+	for (size_t s = 0; s <= segments; s++)
+		bounds.push_back(store.size() * s / segments);
+	offsets.assign(segments + 1, 0);
+
+	ThreadPool	pool(std::min(threads, segments));
+
+	for (size_t s = 0; s < segments; s++)
+	{
+		pool.submit([&, s]() {
+			offsets[s + 1] = rowsSize(store, bounds[s], bounds[s + 1]);
+		});
+	}
+	pool.wait();
+	for (size_t s = 0; s < segments; s++)
+		offsets[s + 1] += offsets[s];
+	total = offsets[segments];
+	if (preallocate && total > 0)
+	{
+		if (posix_fallocate(fd, 0, total) != 0)
+		{
+			::close(fd);
+			return (fail("cannot preallocate " + path));
+		}
+	}
+	else if (ftruncate(fd, total) != 0)
+	{
+		::close(fd);
+		return (fail("cannot resize " + path));
+	}
+	for (size_t s = 0; s < segments; s++)
+	{
+		pool.submit([&, s]() {
+			std::vector<char>	buffer;
+
+			if (!writeRows(fd, store, bounds[s], bounds[s + 1], offsets[s],
+					buffer))
+				ok = false;
+		});
+	}
+	pool.wait();
+	if (::close(fd) != 0 || !ok)
+		return (fail("write failed on " + path));
+	return (true);
+}
+
+const std::string	&CsvWriter::error(void) const
+{
+	return (_error);
+}
+
+bool	CsvWriter::fail(const std::string &message)
+{
+	_error = message;
+	return (false);
+}
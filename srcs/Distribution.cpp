@@ -1,17 +1,41 @@
 #include "Distribution.hpp"
+#include "ThreadPool.hpp"
+#include "CsvWriter.hpp"
+#include "Random.hpp"
+#include "ZstdWriter.hpp"
+#include "Profiler.hpp"
+#include "BlockRing.hpp"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <charconv>
 #include <cmath>
-#include <sstream>
+#include <zdict.h>
+#include <sys/stat.h>
 
-GameEvent::GameEvent(void)
-	: index(0), type("reveal"), multiplier(0.0), amount(0)
+SimulationOptions::SimulationOptions(void)
+	: threads(0), engine(RNG_MT19937), generation(GENERATE_ROUNDS),
+	  shuffle(false), progress(NULL), cancel(NULL), live(NULL),
+	  targetHalfWidth(0.0), confidence(0.99)
 {
 }
 
-GameEvent::GameEvent(int idx, const std::string &t, double mult, int amt)
-	: index(idx), type(t), multiplier(mult), amount(amt)
+ExportOptions::ExportOptions(void)
+	: booksPerFrame(0), dictionarySize(0), lookup(LOOKUP_ROUNDS),
+	  csvThreads(1),
+	  preallocate(false), threads(1),
+	  verbose(true), progress(NULL), cancel(NULL)
+{
+}
+
+ModeAnalysis::ModeAnalysis(void)
+	: totalWeight(0), hitWeight(0), payoutSum(0), payoutSquareSum(0),
+	  minPayout(0), maxPayout(0)
 {
 }
 
@@ -30,6 +54,7 @@ void	Distribution::addMode(const std::string &name, double cost)
 	mode.name = name;
 	mode.cost = cost;
 	mode.totalWeight = 0;
+	mode.samplerReady = false;
 	_modes[name] = mode;
 }
 
@@ -42,52 +67,495 @@ void	Distribution::addMultiplier(const std::string &mode,
 		return ;
 	config.multiplier = multiplier;
 	config.weight = weight;
+	config.payout = payoutUnits(multiplier);
 	_modes[mode].multipliers.push_back(config);
 	_modes[mode].totalWeight += weight;
+	_modes[mode].samplerReady = false;
+}
+
+// Multiplier to PAYOUT_SCALE units, rounded: 1.5 -> 150.
+uint64_t	Distribution::payoutUnits(double multiplier)
+{
+	return (static_cast<uint64_t>(std::llround(multiplier * PAYOUT_SCALE)));
 }
 
-uint64_t	Distribution::pickMultiplier(const GameMode &mode,
-		std::mt19937_64 &rng) const
+void	Distribution::prepareSampler(GameMode &mode)
 {
-	std::uniform_int_distribution<uint64_t>	dist(0, mode.totalWeight - 1);
-	uint64_t								roll;
-	uint64_t								cumulative;
+	std::vector<uint64_t>	weights(mode.multipliers.size());
 
-	roll = dist(rng);
-	cumulative = 0;
+	if (mode.samplerReady)
+		return ;
 	for (size_t i = 0; i < mode.multipliers.size(); i++)
+		weights[i] = mode.multipliers[i].weight;
+	mode.sampler.build(weights);
+	mode.samplerReady = true;
+}
+
+template <class Rng>
+uint64_t	Distribution::pickMultiplier(const GameMode &mode, Rng &rng) const
+{
+	if (mode.sampler.empty())
+		return (0);
+	return (mode.multipliers[mode.sampler.sample(rng)].payout);
+}
+
+// Events of a round are a pure function of its outcome. Writes them when
+// `events` is not NULL and returns how many there are (<= MAX_ROUND_EVENTS).
+size_t	Distribution::roundEvents(uint64_t payout, GameEvent *events)
+{
+	double	mult;
+
+	if (events)
 	{
-		cumulative += mode.multipliers[i].weight;
-		if (roll < cumulative)
-			return (static_cast<uint64_t>(mode.multipliers[i].multiplier * 100));
+		mult = static_cast<double>(payout) / PAYOUT_SCALE;
+		events[0] = GameEvent(0, EVENT_REVEAL, mult, static_cast<int>(payout));
+		events[1] = GameEvent(1, EVENT_FINAL_WIN, mult,
+			static_cast<int>(payout));
 	}
-	return (0);
+	return (2);
 }
 
-void	Distribution::runSimulations(const std::string &mode,
-		size_t count, uint64_t seed)
+// The only place rounds are drawn: emit(i, payout) for rounds [first,
+// last) of a GENERATE_ROUNDS run. Round i only depends on (seed, i /
+// BLOCK_SIZE) and the rounds before it in its block with RNG_MT19937, so
+// those are drawn and dropped when `first` is inside a block; with
+// RNG_PHILOX it depends on (seed, mode, i) alone.
+template <class Emit>
+void	Distribution::drawRounds(const GameMode &mode, size_t first,
+		size_t last, uint64_t seed, RngEngine engine, Emit emit) const
 {
-	std::mt19937_64	rng(seed);
-	Simulation		sim;
-	double			mult;
+	size_t	end;
 
-	if (_modes.find(mode) == _modes.end())
+	if (engine == RNG_PHILOX)
+	{
+		uint64_t	key = streamSeed(seed, hashString(mode.name));
+
+		for (size_t i = first; i < last; i++)
+		{
+			PhiloxStream	rng(key, i);
+
+			emit(i, pickMultiplier(mode, rng));
+		}
 		return ;
-	_modes[mode].simulations.clear();
-	_modes[mode].simulations.reserve(count);
-	for (size_t i = 0; i < count; i++)
+	}
+	for (size_t block = first / BLOCK_SIZE; block * BLOCK_SIZE < last;
+		block++)
+	{
+		std::mt19937_64	rng(streamSeed(seed, block));
+
+		end = std::min((block + 1) * BLOCK_SIZE, last);
+		for (size_t i = block * BLOCK_SIZE; i < first; i++)
+			pickMultiplier(mode, rng);
+		for (size_t i = std::max(block * BLOCK_SIZE, first); i < end; i++)
+			emit(i, pickMultiplier(mode, rng));
+	}
+}
+
+// Rounds [block * BLOCK_SIZE, ...) only depend on (seed, block) with
+// RNG_MT19937, and on (seed, mode, id) with RNG_PHILOX, so blocks can be
+// generated in any order on any thread. Round i goes to row i - base of
+// `store`, which ends the run at round base + store.size().
+void	Distribution::simulateBlock(const GameMode &mode,
+		SimulationStore &store, size_t base, size_t block, uint64_t seed,
+		RngEngine engine) const
+{
+	ScopedTimer		timer(mode.name, PROFILE_GENERATE);
+	size_t			first;
+
+	first = block * BLOCK_SIZE;
+	drawRounds(mode, first, std::min(first + BLOCK_SIZE, base + store.size()),
+		seed, engine, [&](size_t i, uint64_t payout) {
+			store.setRow(i - base, i + 1, 1, payout);
+			store.setEventCount(i - base, roundEvents(payout, NULL));
+		});
+}
+
+// Rows [first, last) of `store`, once its event index is built.
+void	Distribution::emitBlockEvents(const GameMode &mode,
+		SimulationStore &store, size_t first, size_t last) const
+{
+	ScopedTimer		timer(mode.name, PROFILE_EVENTS);
+
+	for (size_t i = first; i < last; i++)
+		roundEvents(store.payouts()[i], store.eventSlot(i));
+}
+
+// Runs job(block) for every block, on `pool` when there is one.
+static void	forEachBlock(ThreadPool *pool, size_t blocks,
+		const std::function<void(size_t)> &job)
+{
+	std::atomic<size_t>	nextBlock(0);
+
+	auto	worker = [&]() {
+		size_t	block;
+
+		while ((block = nextBlock++) < blocks)
+			job(block);
+	};
+
+	if (!pool)
 	{
-		sim.id = i + 1;
-		sim.weight = 1;
-		sim.payoutMultiplier = pickMultiplier(_modes[mode], rng);
-		sim.events.clear();
-		mult = sim.payoutMultiplier / 100.0;
-		sim.events.push_back(GameEvent(0, "reveal", mult,
-			static_cast<int>(sim.payoutMultiplier)));
-		sim.events.push_back(GameEvent(1, "finalWin", mult,
-			static_cast<int>(sim.payoutMultiplier)));
-		_modes[mode].simulations.push_back(sim);
+		worker();
+		return ;
 	}
+	for (size_t t = 0; t < pool->size(); t++)
+		pool->submit(worker);
+	pool->wait();
+}
+
+static bool	isCancelled(const std::atomic<bool> *cancel)
+{
+	return (cancel && cancel->load(std::memory_order_relaxed));
+}
+
+static void	addProgress(std::atomic<size_t> *progress, size_t amount)
+{
+	if (progress)
+		progress->fetch_add(amount, std::memory_order_relaxed);
+}
+
+// Sequential binomials: multiplier i takes Binomial(rows left, w_i / weight
+// left) of the rows, an exact multinomial split of `count`. ends[i] is one
+// past the last row of multiplier i once rows are grouped by multiplier.
+// Instantiated for std::mt19937_64 and PhiloxStream (Sweep uses it too).
+template <class Rng>
+void	Distribution::multinomialCounts(
+		const std::vector<MultiplierConfig> &rows, size_t count, Rng &rng,
+		std::vector<uint64_t> &ends)
+{
+	uint64_t	rowsLeft;
+	uint64_t	weightLeft;
+	uint64_t	taken;
+
+	rowsLeft = count;
+	weightLeft = 0;
+	for (size_t i = 0; i < rows.size(); i++)
+		weightLeft += rows[i].weight;
+	ends.resize(rows.size());
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		const uint64_t	weight = rows[i].weight;
+
+		if (weight == 0)
+			taken = 0;
+		else if (weight >= weightLeft)
+			taken = rowsLeft;
+		else
+			taken = randomBinomial(rng, rowsLeft,
+				static_cast<double>(weight) / weightLeft);
+		rowsLeft -= taken;
+		weightLeft -= weight;
+		ends[i] = count - rowsLeft;
+	}
+}
+
+template void	Distribution::multinomialCounts<std::mt19937_64>(
+	const std::vector<MultiplierConfig> &, size_t, std::mt19937_64 &,
+	std::vector<uint64_t> &);
+template void	Distribution::multinomialCounts<PhiloxStream>(
+	const std::vector<MultiplierConfig> &, size_t, PhiloxStream &,
+	std::vector<uint64_t> &);
+
+// k binomial draws, then a linear fill of each multiplier's run of rows.
+// The optional shuffle is sequential (it consumes `rng`), the fills are not;
+// block statistics are taken once rows are in their final order. Returns
+// false when cancelled.
+template <class Rng>
+bool	Distribution::generateMultinomial(GameMode &mode, Rng &rng,
+		const SimulationOptions &options, LiveStatistics &live,
+		ThreadPool *pool) const
+{
+	SimulationStore			&store = mode.simulations;
+	std::vector<uint64_t>	ends;
+	size_t					blocks;
+
+	multinomialCounts(mode.multipliers, store.size(), rng, ends);
+	blocks = (store.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	forEachBlock(pool, blocks, [&](size_t block) {
+		size_t	first = block * BLOCK_SIZE;
+		size_t	last = std::min(first + BLOCK_SIZE, store.size());
+		size_t	m = std::upper_bound(ends.begin(), ends.end(), first)
+			- ends.begin();
+
+		if (isCancelled(options.cancel))
+			return ;
+
+		ScopedTimer	timer(mode.name, PROFILE_GENERATE);
+
+		for (size_t i = first; i < last; i++)
+		{
+			while (m < ends.size() && ends[m] <= i)
+				m++;
+			store.setRow(i, i + 1, 1,
+				m < ends.size() ? mode.multipliers[m].payout : 0);
+		}
+		addProgress(options.progress, last - first);
+	});
+	if (options.shuffle)
+	{
+		for (size_t i = store.size(); i > 1; i--)
+		{
+			if (i % BLOCK_SIZE == 0 && isCancelled(options.cancel))
+				return (false);
+			store.swapOutcomes(i - 1, randomBelow(rng, i));
+		}
+	}
+	forEachBlock(pool, blocks, [&](size_t block) {
+		size_t			first = block * BLOCK_SIZE;
+		size_t			last = std::min(first + BLOCK_SIZE, store.size());
+		PayoutMoments	moments;
+		ScopedTimer		timer(mode.name, PROFILE_STATISTICS);
+
+		for (size_t i = first; i < last; i++)
+			store.setEventCount(i, roundEvents(store.payouts()[i], NULL));
+		moments.add(store, first, last);
+		live.addBlock(block, moments);
+	});
+	return (!isCancelled(options.cancel));
+}
+
+// Early stopping: blocks go in batches that double in size until `live`
+// has found the first prefix meeting the target. Blocks after that prefix
+// are dropped, so the result only depends on the seed, not on scheduling.
+// The paytable's exact sd bounds the sample one from below (see
+// LiveStatistics). Returns false when cancelled.
+bool	Distribution::simulateToPrecision(GameMode &mode, size_t count,
+		uint64_t seed, const SimulationOptions &options, LiveStatistics &live,
+		ThreadPool *pool) const
+{
+	size_t	blocks;
+	size_t	done;
+	size_t	batch;
+	size_t	last;
+
+	blocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	done = 0;
+	batch = pool ? pool->size() * 2 : 2;
+	live.setTarget(options.targetHalfWidth,
+		normalQuantile((1.0 + options.confidence) / 2.0),
+		analyzeRows(mode.multipliers).stats.stdDeviation);
+	while (done < blocks && !live.targetReached())
+	{
+		last = std::min(blocks, done + batch);
+		mode.simulations.resize(std::min(last * BLOCK_SIZE, count));
+		forEachBlock(pool, last - done, [&](size_t i) {
+			size_t			block = done + i;
+			size_t			first = block * BLOCK_SIZE;
+			size_t			end = std::min(first + BLOCK_SIZE, count);
+			PayoutMoments	moments;
+
+			if (isCancelled(options.cancel) || live.targetReached())
+				return ;
+			simulateBlock(mode, mode.simulations, 0, block, seed,
+				options.engine);
+			{
+				ScopedTimer	timer(mode.name, PROFILE_STATISTICS);
+
+				moments.add(mode.simulations, first, end);
+			}
+			live.addBlock(block, moments);
+			addProgress(options.progress, end - first);
+		});
+		if (isCancelled(options.cancel))
+			return (false);
+		done = last;
+		batch *= 2;
+	}
+	// resize() dropped the event counts of the batches before: set them
+	// again for the rows kept
+	count = std::min(live.prefixBlocks() * BLOCK_SIZE, count);
+	mode.simulations.resize(count);
+	forEachBlock(pool, (count + BLOCK_SIZE - 1) / BLOCK_SIZE,
+		[&](size_t block) {
+			SimulationStore	&store = mode.simulations;
+			size_t			last = std::min((block + 1) * BLOCK_SIZE, count);
+
+			for (size_t i = block * BLOCK_SIZE; i < last; i++)
+				store.setEventCount(i, roundEvents(store.payouts()[i], NULL));
+		});
+	return (true);
+}
+
+// Statistics are taken block by block right after generation, and merged in
+// block order (see LiveStatistics). Returns false for an unknown mode, or
+// when options.cancel was raised; a cancelled mode is left without
+// simulations.
+bool	Distribution::runSimulations(const std::string &mode,
+		size_t count, uint64_t seed, const SimulationOptions &options)
+{
+	std::map<std::string, GameMode>::iterator	it;
+	std::unique_ptr<ThreadPool>					pool;
+	LiveStatistics								ownLive;
+	LiveStatistics								*live;
+	size_t										blocks;
+	size_t										threads;
+	bool										earlyStop;
+	bool										completed;
+
+	it = _modes.find(mode);
+	if (it == _modes.end())
+		return (false);
+	GameMode	&gameMode = it->second;
+	ScopedTimer	timer(gameMode.name, PROFILE_SIMULATE);
+
+	earlyStop = options.generation == GENERATE_ROUNDS
+		&& options.targetHalfWidth > 0.0;
+	prepareSampler(gameMode);
+	gameMode.simulations.resize(earlyStop ? 0 : count);
+	blocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	threads = std::min(ThreadPool::resolveThreads(options.threads), blocks);
+	if (threads > 1)
+		pool.reset(new ThreadPool(threads));
+	live = options.live ? options.live : &ownLive;
+	live->reset(blocks);
+	if (options.generation == GENERATE_MULTINOMIAL)
+	{
+		uint64_t	key = streamSeed(seed, hashString(mode));
+
+		if (options.engine == RNG_PHILOX)
+		{
+			PhiloxStream	rng(key, 0);
+
+			completed = generateMultinomial(gameMode, rng, options, *live,
+				pool.get());
+		}
+		else
+		{
+			std::mt19937_64	rng(key);
+
+			completed = generateMultinomial(gameMode, rng, options, *live,
+				pool.get());
+		}
+	}
+	else if (earlyStop)
+	{
+		completed = simulateToPrecision(gameMode, count, seed, options,
+			*live, pool.get());
+		count = gameMode.simulations.size();
+		blocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	}
+	else
+	{
+		forEachBlock(pool.get(), blocks, [&](size_t block) {
+			size_t			first = block * BLOCK_SIZE;
+			size_t			last = std::min(first + BLOCK_SIZE, count);
+			PayoutMoments	moments;
+
+			if (isCancelled(options.cancel))
+				return ;
+			simulateBlock(gameMode, gameMode.simulations, 0, block, seed,
+				options.engine);
+			{
+				ScopedTimer	timer(gameMode.name, PROFILE_STATISTICS);
+
+				moments.add(gameMode.simulations, first, last);
+			}
+			live->addBlock(block, moments);
+			addProgress(options.progress, last - first);
+		});
+		completed = !isCancelled(options.cancel);
+	}
+	gameMode.moments = PayoutMoments();
+	gameMode.stats = ModeStatistics();
+	if (!completed)
+	{
+		gameMode.simulations.clear();
+		return (false);
+	}
+	gameMode.simulations.buildEventIndex();
+	forEachBlock(pool.get(), blocks, [&](size_t block) {
+		emitBlockEvents(gameMode, gameMode.simulations, block * BLOCK_SIZE,
+			std::min((block + 1) * BLOCK_SIZE, count));
+	});
+	gameMode.moments = live->prefix();
+	gameMode.stats = gameMode.moments.statistics();
+	Profiler::instance().addRounds(gameMode.name, count);
+	Profiler::instance().sampleMemory(gameMode.name);
+	return (true);
+}
+
+// Regenerates book `id` exactly as runSimulations(mode, _, seed, options)
+// produced it. Constant time with RNG_PHILOX; RNG_MT19937 has to replay the
+// rounds before it in the same block. GENERATE_MULTINOMIAL books are
+// replayed from the k counts of the stored run, unless they were shuffled.
+bool	Distribution::replaySimulation(const std::string &mode, uint64_t id,
+		uint64_t seed, const SimulationOptions &options,
+		Simulation &sim) const
+{
+	std::map<std::string, GameMode>::const_iterator	it;
+	const GameMode									*source;
+	GameMode										copy;
+	uint64_t										index;
+
+	it = _modes.find(mode);
+	if (it == _modes.end() || id == 0)
+		return (false);
+	index = id - 1;
+	source = &it->second;
+	if (!source->samplerReady)
+	{
+		std::vector<uint64_t>	weights(source->multipliers.size());
+
+		copy.name = source->name;
+		copy.multipliers = source->multipliers;
+		copy.totalWeight = source->totalWeight;
+		for (size_t i = 0; i < copy.multipliers.size(); i++)
+			weights[i] = copy.multipliers[i].weight;
+		copy.sampler.build(weights);
+		source = &copy;
+	}
+	if (options.generation == GENERATE_MULTINOMIAL)
+	{
+		std::vector<uint64_t>	ends;
+		uint64_t				key = streamSeed(seed, hashString(mode));
+		size_t					count = it->second.simulations.size();
+		size_t					m;
+
+		if (options.shuffle || index >= count)
+			return (false);
+		if (options.engine == RNG_PHILOX)
+		{
+			PhiloxStream	rng(key, 0);
+
+			multinomialCounts(source->multipliers, count, rng, ends);
+		}
+		else
+		{
+			std::mt19937_64	rng(key);
+
+			multinomialCounts(source->multipliers, count, rng, ends);
+		}
+		m = std::upper_bound(ends.begin(), ends.end(), index) - ends.begin();
+		sim.payoutMultiplier = m < ends.size()
+			? source->multipliers[m].payout : 0;
+	}
+	else
+	{
+		drawRounds(*source, index, index + 1, seed, options.engine,
+			[&](size_t, uint64_t payout) { sim.payoutMultiplier = payout; });
+	}
+	sim.id = id;
+	sim.weight = 1;
+	sim.events.resize(MAX_ROUND_EVENTS);
+	sim.events.resize(roundEvents(sim.payoutMultiplier, sim.events.data()));
+	return (true);
+}
+
+// Payouts of rounds [0, payouts.size()) of `mode`, as runSimulations draws
+// them with GENERATE_ROUNDS: pickMultiplier alone, without the store or the
+// events. false for an unknown mode.
+bool	Distribution::samplePayouts(const std::string &mode, uint64_t seed,
+		RngEngine engine, std::vector<uint64_t> &payouts)
+{
+	std::map<std::string, GameMode>::iterator	it;
+
+	it = _modes.find(mode);
+	if (it == _modes.end())
+		return (false);
+	prepareSampler(it->second);
+	drawRounds(it->second, 0, payouts.size(), seed, engine,
+		[&](size_t i, uint64_t payout) { payouts[i] = payout; });
+	return (true);
 }
 
 size_t	Distribution::modeCount(void) const
@@ -105,219 +573,512 @@ size_t	Distribution::simulationCount(const std::string &mode) const
 	return (it->second.simulations.size());
 }
 
-double	Distribution::getRTP(const std::string &mode) const
+// Fills `stats` from the sums. The variance numerator W * S2 - S1^2 >= 0
+// (Cauchy-Schwarz) is exact when W * S2 fits in 128 bits, which bounds
+// S1^2 as well; larger weights or payouts fall back to long double, as in
+// PayoutMoments::statistics.
+void	ModeAnalysis::finish(void)
 {
-	std::map<std::string, GameMode>::const_iterator	it;
-	double											totalPayout;
-	uint64_t										totalWeight;
+	const long double	scale = PAYOUT_SCALE;
+	long double			weight;
+	long double			mean;
 
-	it = _modes.find(mode);
-	if (it == _modes.end() || it->second.simulations.empty())
-		return (0.0);
-	totalPayout = 0.0;
-	totalWeight = 0;
-	for (size_t i = 0; i < it->second.simulations.size(); i++)
+	stats = ModeStatistics();
+	if (totalWeight == 0)
+		return ;
+	weight = totalWeight;
+	mean = static_cast<long double>(payoutSum) / weight;
+	stats.rtp = static_cast<double>(mean / scale);
+	stats.meanPayout = stats.rtp;
+	if (payoutSquareSum <= ~static_cast<unsigned __int128>(0) / totalWeight)
+		stats.variance = static_cast<double>(static_cast<long double>(
+			payoutSquareSum * totalWeight - payoutSum * payoutSum)
+			/ (weight * weight) / (scale * scale));
+	else
+		stats.variance = static_cast<double>(std::max(0.0L,
+			static_cast<long double>(payoutSquareSum) / weight - mean * mean)
+			/ (scale * scale));
+	stats.stdDeviation = std::sqrt(stats.variance);
+	if (stats.meanPayout >= 0.0001)
+		stats.volatility = stats.stdDeviation / stats.meanPayout;
+	stats.hitFrequency = static_cast<double>(hitWeight / weight * 100.0L);
+	stats.minPayout = static_cast<double>(minPayout) / PAYOUT_SCALE;
+	stats.maxPayout = static_cast<double>(maxPayout) / PAYOUT_SCALE;
+}
+
+// Closed-form metrics in O(k) over the paytable, with the same meaning as
+// the simulated ones: the expected RTP, mean, variance, hit frequency and
+// payout range of a single round. `rows` are added to the sums of `base`,
+// so a paytable analysed in two parts gives the same result as a whole.
+ModeAnalysis	Distribution::analyzeRows(
+		const std::vector<MultiplierConfig> &rows, const ModeAnalysis &base)
+{
+	ModeAnalysis	analysis;
+	bool			first;
+
+	analysis = base;
+	first = analysis.totalWeight == 0;
+	for (size_t i = 0; i < rows.size(); i++)
 	{
-		totalPayout += it->second.simulations[i].weight
-			* (it->second.simulations[i].payoutMultiplier / 100.0);
-		totalWeight += it->second.simulations[i].weight;
+		const unsigned __int128	payout = rows[i].payout;
+
+		if (rows[i].weight == 0)
+			continue ;
+		analysis.totalWeight += rows[i].weight;
+		analysis.payoutSum += payout * rows[i].weight;
+		analysis.payoutSquareSum += payout * payout * rows[i].weight;
+		if (rows[i].payout > 0)
+			analysis.hitWeight += rows[i].weight;
+		if (first || rows[i].payout < analysis.minPayout)
+			analysis.minPayout = rows[i].payout;
+		if (first || rows[i].payout > analysis.maxPayout)
+			analysis.maxPayout = rows[i].payout;
+		first = false;
 	}
-	return (totalPayout / totalWeight);
+	analysis.finish();
+	return (analysis);
 }
 
-double	Distribution::getMeanPayout(const std::string &mode) const
+ModeAnalysis	Distribution::analyzeMode(const std::string &mode) const
 {
 	std::map<std::string, GameMode>::const_iterator	it;
-	double											sum;
-	size_t											count;
 
 	it = _modes.find(mode);
-	if (it == _modes.end() || it->second.simulations.empty())
-		return (0.0);
-	sum = 0.0;
-	count = it->second.simulations.size();
-	for (size_t i = 0; i < count; i++)
-		sum += it->second.simulations[i].payoutMultiplier / 100.0;
-	return (sum / count);
+	if (it == _modes.end())
+		return (ModeAnalysis());
+	return (analyzeRows(it->second.multipliers));
 }
 
-double	Distribution::getVariance(const std::string &mode) const
+// The rounds of the last run of `mode`, empty for an unknown mode.
+const SimulationStore	&Distribution::getSimulations(
+		const std::string &mode) const
 {
+	static const SimulationStore					empty;
 	std::map<std::string, GameMode>::const_iterator	it;
-	double											mean;
-	double											sumSquaredDiff;
-	double											payout;
-	size_t											count;
 
 	it = _modes.find(mode);
-	if (it == _modes.end() || it->second.simulations.empty())
-		return (0.0);
-	mean = getMeanPayout(mode);
-	sumSquaredDiff = 0.0;
-	count = it->second.simulations.size();
-	for (size_t i = 0; i < count; i++)
-	{
-		payout = it->second.simulations[i].payoutMultiplier / 100.0;
-		sumSquaredDiff += (payout - mean) * (payout - mean);
-	}
-	return (sumSquaredDiff / count);
+	if (it == _modes.end())
+		return (empty);
+	return (it->second.simulations);
 }
 
-double	Distribution::getStandardDeviation(const std::string &mode) const
+// The paytable of `mode`, empty for an unknown mode.
+const std::vector<MultiplierConfig>	&Distribution::getMultipliers(
+		const std::string &mode) const
 {
-	return (std::sqrt(getVariance(mode)));
+	static const std::vector<MultiplierConfig>		empty;
+	std::map<std::string, GameMode>::const_iterator	it;
+
+	it = _modes.find(mode);
+	if (it == _modes.end())
+		return (empty);
+	return (it->second.multipliers);
 }
 
-double	Distribution::getVolatility(const std::string &mode) const
+// Replaces the weights of `mode` with the solver's and discards its
+// simulations, which no longer match the paytable. On failure the mode is
+// left untouched and result.error says why.
+bool	Distribution::solveWeights(const std::string &mode,
+		const SolverTargets &targets, SolverResult &result)
 {
-	double	mean;
-	double	stdDev;
+	std::map<std::string, GameMode>::iterator	it;
 
-	mean = getMeanPayout(mode);
-	if (mean < 0.0001)
-		return (0.0);
-	stdDev = getStandardDeviation(mode);
-	return (stdDev / mean);
+	it = _modes.find(mode);
+	if (it == _modes.end())
+	{
+		result = SolverResult();
+		result.error = "unknown mode '" + mode + "'";
+		return (false);
+	}
+	GameMode		&gameMode = it->second;
+	WeightSolver	solver(gameMode.multipliers, targets);
+
+	if (!solver.solve(result))
+		return (false);
+	gameMode.totalWeight = 0;
+	for (size_t i = 0; i < gameMode.multipliers.size(); i++)
+	{
+		gameMode.multipliers[i].weight = result.weights[i];
+		gameMode.totalWeight += result.weights[i];
+	}
+	gameMode.samplerReady = false;
+	gameMode.simulations.clear();
+	gameMode.moments = PayoutMoments();
+	gameMode.stats = ModeStatistics();
+	return (true);
 }
 
-double	Distribution::getHitFrequency(const std::string &mode) const
+// Checks the simulated RTP of `mode` against its exact RTP: they must agree
+// within the `confidence` interval of the simulation, or the sampler does
+// not reproduce the paytable.
+bool	Distribution::verifyRTP(const std::string &mode, double confidence,
+		std::string &error) const
 {
-	std::map<std::string, GameMode>::const_iterator	it;
-	size_t											winCount;
-	size_t											count;
+	double	exact;
+	double	simulated;
+	double	halfWidth;
 
-	it = _modes.find(mode);
-	if (it == _modes.end() || it->second.simulations.empty())
-		return (0.0);
-	winCount = 0;
-	count = it->second.simulations.size();
-	for (size_t i = 0; i < count; i++)
+	if (getStatistics(mode).count == 0)
 	{
-		if (it->second.simulations[i].payoutMultiplier > 0)
-			winCount++;
+		error = "mode '" + mode + "' has no simulations";
+		return (false);
 	}
-	return ((double)winCount / count * 100.0);
+	exact = analyzeMode(mode).stats.rtp;
+	simulated = getRTP(mode);
+	halfWidth = getRTPHalfWidth(mode, confidence);
+	if (std::fabs(simulated - exact) > halfWidth)
+	{
+		error = "mode '" + mode + "': simulated RTP "
+			+ std::to_string(simulated * 100.0) + "% is outside exact "
+			+ std::to_string(exact * 100.0) + "% +/- "
+			+ std::to_string(halfWidth * 100.0) + "%";
+		return (false);
+	}
+	return (true);
 }
 
-double	Distribution::getMinPayout(const std::string &mode) const
+const ModeStatistics	&Distribution::getStatistics(
+		const std::string &mode) const
 {
+	static const ModeStatistics						empty;
 	std::map<std::string, GameMode>::const_iterator	it;
-	double											minVal;
-	double											payout;
 
 	it = _modes.find(mode);
-	if (it == _modes.end() || it->second.simulations.empty())
-		return (0.0);
-	minVal = it->second.simulations[0].payoutMultiplier / 100.0;
-	for (size_t i = 1; i < it->second.simulations.size(); i++)
-	{
-		payout = it->second.simulations[i].payoutMultiplier / 100.0;
-		if (payout < minVal)
-			minVal = payout;
-	}
-	return (minVal);
+	if (it == _modes.end())
+		return (empty);
+
+	ScopedTimer	timer(it->second.name, PROFILE_STATISTICS, false);
+
+	return (it->second.stats);
 }
 
-double	Distribution::getMaxPayout(const std::string &mode) const
+// Half-width of the `confidence` interval on the simulated RTP, e.g. the
+// interval reached by an early-stopped run.
+double	Distribution::getRTPHalfWidth(const std::string &mode,
+		double confidence) const
 {
 	std::map<std::string, GameMode>::const_iterator	it;
-	double											maxVal;
-	double											payout;
 
 	it = _modes.find(mode);
-	if (it == _modes.end() || it->second.simulations.empty())
+	if (it == _modes.end())
 		return (0.0);
-	maxVal = it->second.simulations[0].payoutMultiplier / 100.0;
-	for (size_t i = 1; i < it->second.simulations.size(); i++)
-	{
-		payout = it->second.simulations[i].payoutMultiplier / 100.0;
-		if (payout > maxVal)
-			maxVal = payout;
-	}
-	return (maxVal);
+
+	ScopedTimer	timer(it->second.name, PROFILE_STATISTICS, false);
+
+	return (it->second.moments.rtpHalfWidth(
+		normalQuantile((1.0 + confidence) / 2.0)));
 }
 
-std::string	Distribution::formatGameEvent(const GameEvent &event) const
+double	Distribution::getRTP(const std::string &mode) const
 {
-	std::ostringstream	json;
+	return (getStatistics(mode).rtp);
+}
 
-	json << "{\"index\":" << event.index;
-	json << ",\"type\":\"" << event.type << "\"";
-	json << ",\"multiplier\":" << std::fixed << std::setprecision(1)
-		 << event.multiplier;
-	json << ",\"amount\":" << event.amount << "}";
-	return (json.str());
+double	Distribution::getMeanPayout(const std::string &mode) const
+{
+	return (getStatistics(mode).meanPayout);
 }
 
-std::string	Distribution::formatSimulation(const Simulation &sim) const
+double	Distribution::getVariance(const std::string &mode) const
 {
-	std::ostringstream	json;
+	return (getStatistics(mode).variance);
+}
 
-	json << "{\"id\":" << sim.id;
-	json << ",\"payoutMultiplier\":" << sim.payoutMultiplier;
-	json << ",\"events\":[";
-	for (size_t i = 0; i < sim.events.size(); i++)
+double	Distribution::getStandardDeviation(const std::string &mode) const
+{
+	return (getStatistics(mode).stdDeviation);
+}
+
+double	Distribution::getVolatility(const std::string &mode) const
+{
+	return (getStatistics(mode).volatility);
+}
+
+double	Distribution::getHitFrequency(const std::string &mode) const
+{
+	return (getStatistics(mode).hitFrequency);
+}
+
+double	Distribution::getMinPayout(const std::string &mode) const
+{
+	return (getStatistics(mode).minPayout);
+}
+
+double	Distribution::getMaxPayout(const std::string &mode) const
+{
+	return (getStatistics(mode).maxPayout);
+}
+
+// JSON writers append straight into a caller-owned buffer with
+// std::to_chars: no stream, no locale, no allocation once the buffer has
+// grown. Output is byte-identical to the former std::ostringstream
+// formatting (multipliers as std::fixed with one decimal).
+static void	appendUnsigned(std::string &out, uint64_t value)
+{
+	char				buffer[24];
+	std::to_chars_result	result;
+
+	result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	out.append(buffer, result.ptr);
+}
+
+static void	appendSigned(std::string &out, int64_t value)
+{
+	char				buffer[24];
+	std::to_chars_result	result;
+
+	result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	out.append(buffer, result.ptr);
+}
+
+static void	appendFixed1(std::string &out, double value)
+{
+	char				buffer[352];
+	std::to_chars_result	result;
+
+	result = std::to_chars(buffer, buffer + sizeof(buffer), value,
+		std::chars_format::fixed, 1);
+	out.append(buffer, result.ptr);
+}
+
+void	Distribution::formatGameEvent(std::string &out,
+		const GameEvent &event) const
+{
+	out += "{\"index\":";
+	appendUnsigned(out, event.index);
+	out += ",\"type\":\"";
+	out += eventTypeName(event.type);
+	out += "\",\"multiplier\":";
+	appendFixed1(out, event.multiplier);
+	out += ",\"amount\":";
+	appendSigned(out, event.amount);
+	out += '}';
+}
+
+void	Distribution::formatSimulation(std::string &out,
+		const SimulationStore &store, size_t row) const
+{
+	out += "{\"id\":";
+	appendUnsigned(out, store.ids()[row]);
+	out += ",\"payoutMultiplier\":";
+	appendUnsigned(out, store.payouts()[row]);
+	out += ",\"events\":[";
+	for (size_t i = store.eventBegin(row); i < store.eventEnd(row); i++)
 	{
-		if (i > 0)
-			json << ",";
-		json << formatGameEvent(sim.events[i]);
+		if (i > store.eventBegin(row))
+			out += ',';
+		formatGameEvent(out, store.events()[i]);
 	}
-	json << "]}";
-	return (json.str());
+	out += "]}";
 }
 
 bool	Distribution::exportCSV(const std::string &path,
-		const GameMode &mode) const
+		const std::string &mode, const SimulationStore &store,
+		const ExportOptions &options, std::string &error) const
 {
-	std::ofstream	file(path);
+	CsvWriter	writer;
+	struct stat	info;
 
-	if (!file.is_open())
 	{
-		std::cerr << "Error: cannot open " << path << std::endl;
+		ScopedTimer	timer(mode, PROFILE_LOOKUP);
+
+		if (!writer.write(path, store, options.csvThreads,
+				options.preallocate))
+		{
+			error = writer.error();
+			return (false);
+		}
+		if (Profiler::instance().enabled() && stat(path.c_str(), &info) == 0)
+			timer.addBytes(info.st_size);
+	}
+	Profiler::instance().sampleMemory(mode);
+	return (true);
+}
+
+// Rows are formatted into a buffer that is streamed through the compressor
+// every FLUSH_SIZE bytes, so memory stays constant whatever the size of the
+// book. A seekable file also ends a frame after every booksPerFrame rows.
+// Book ids are row + 1, so BookReader finds book `id` in frame
+// (id - 1) / booksPerFrame. A non-empty `dictionary` is referenced by every
+// frame.
+bool	Distribution::exportJSONLCompressed(const std::string &path,
+		const std::string &mode, const SimulationStore &store,
+		const ExportOptions &options, const std::string &dictionary,
+		std::string &error) const
+{
+	static const size_t	FLUSH_SIZE = 64 * 1024;
+	ZstdWriter			writer;
+	std::string			buffer;
+	size_t				reported;
+	size_t				frameEnd;
+	bool				ok;
+
+	if (!writer.open(path, options.compression, mode)
+		|| (!dictionary.empty() && !writer.setDictionary(dictionary)))
+	{
+		error = writer.error();
 		return (false);
 	}
-	for (size_t i = 0; i < mode.simulations.size(); i++)
+	writer.setSeekable(options.booksPerFrame > 0);
+	frameEnd = options.booksPerFrame > 0
+		? std::min(options.booksPerFrame, store.size()) : store.size();
+	buffer.reserve(FLUSH_SIZE + 4096);
+	reported = 0;
+	ok = true;
+	for (size_t i = 0; ok && i < store.size(); )
+	{
+		{
+			ScopedTimer	timer(mode, PROFILE_FORMAT);
+
+			for (; i < frameEnd && buffer.size() < FLUSH_SIZE; i++)
+			{
+				formatSimulation(buffer, store, i);
+				buffer += '\n';
+			}
+			timer.addBytes(buffer.size());
+		}
+		ok = writer.write(buffer.data(), buffer.size());
+		buffer.clear();
+		if (ok && i == frameEnd && i < store.size())
+		{
+			ok = writer.endFrame();
+			frameEnd = std::min(frameEnd + options.booksPerFrame,
+				store.size());
+		}
+		if (isCancelled(options.cancel))
+		{
+			error = "cancelled";
+			return (false);
+		}
+		addProgress(options.progress, i - reported);
+		reported = i;
+	}
+	if (!writer.close())
 	{
-		file << mode.simulations[i].id << ","
-			 << mode.simulations[i].weight << ","
-			 << mode.simulations[i].payoutMultiplier << "\n";
+		error = writer.error();
+		return (false);
 	}
-	file.close();
+	Profiler::instance().sampleMemory(mode);
 	return (true);
 }
 
-bool	Distribution::exportJSONLCompressed(const std::string &path,
-		const GameMode &mode) const
+// A sample is what a frame holds: a run of `sampleBooks` consecutive books
+// (at most MAX_SAMPLE bytes). Samples start evenly over the store, about
+// SAMPLE_RATIO times the dictionary size in total as zstd advises; single
+// books make a dictionary that hurts frames of hundreds of books. Returns
+// false when zstd cannot train on them (e.g. too few books): the books are
+// then compressed without a dictionary.
+bool	Distribution::trainDictionary(const std::string &mode,
+		const SimulationStore &store, size_t capacity, size_t sampleBooks,
+		std::string &dictionary) const
 {
-	std::string	jsonData;
+	static const size_t	SAMPLE_RATIO = 100;
+	static const size_t	MAX_SAMPLE = 64 * 1024;
+	ScopedTimer			timer(mode, PROFILE_DICTIONARY);
+	std::string			samples;
+	std::vector<size_t>	sizes;
+	size_t				count;
+	size_t				ret;
 
-	for (size_t i = 0; i < mode.simulations.size(); i++)
-		jsonData += formatSimulation(mode.simulations[i]) + "\n";
-
-	size_t				compressBound = ZSTD_compressBound(jsonData.size());
-	std::vector<char>	compressedData(compressBound);
-	size_t				compressedSize;
+	dictionary.clear();
+	if (store.size() == 0 || sampleBooks == 0)
+		return (false);
+	for (size_t i = 0; i < sampleBooks && i < store.size()
+		&& samples.size() < MAX_SAMPLE; i++)
+	{
+		formatSimulation(samples, store, i);
+		samples += '\n';
+	}
+	count = std::max<size_t>(1, std::min(store.size() / std::min(sampleBooks,
+		store.size()), capacity * SAMPLE_RATIO / samples.size()));
+	samples.clear();
+	for (size_t s = 0; s < count; s++)
+	{
+		size_t	before = samples.size();
 
-	compressedSize = ZSTD_compress(compressedData.data(), compressBound,
-		jsonData.data(), jsonData.size(), 3);
-	if (ZSTD_isError(compressedSize))
+		for (size_t i = store.size() / count * s; i < store.size()
+			&& i < store.size() / count * s + sampleBooks
+			&& samples.size() - before < MAX_SAMPLE; i++)
+		{
+			formatSimulation(samples, store, i);
+			samples += '\n';
+		}
+		sizes.push_back(samples.size() - before);
+	}
+	dictionary.resize(capacity);
+	ret = ZDICT_trainFromBuffer(&dictionary[0], capacity, samples.data(),
+		sizes.data(), static_cast<unsigned>(sizes.size()));
+	if (ZDICT_isError(ret))
 	{
-		std::cerr << "Error: ZSTD compression failed" << std::endl;
+		dictionary.clear();
 		return (false);
 	}
+	dictionary.resize(ret);
+	return (true);
+}
 
+static bool	writeFile(const std::string &path, const std::string &data,
+		std::string &error)
+{
 	std::ofstream	file(path, std::ios::binary);
 
-	if (!file.is_open())
+	file.write(data.data(), data.size());
+	file.close();
+	if (file.fail())
 	{
-		std::cerr << "Error: cannot open " << path << std::endl;
+		error = "cannot write " + path;
 		return (false);
 	}
-	file.write(compressedData.data(), compressedSize);
-	file.close();
 	return (true);
 }
 
+// One row per distinct payout, in increasing payout order, with ids 1..k.
+// Rows whose weight would be 0 are left out.
+void	Distribution::aggregateOutcomes(const GameMode &mode,
+		LookupTable lookup, SimulationStore &store)
+{
+	std::map<uint64_t, uint64_t>	weights;
+
+	if (lookup == LOOKUP_CONFIGURED)
+	{
+		for (size_t i = 0; i < mode.multipliers.size(); i++)
+			weights[mode.multipliers[i].payout] += mode.multipliers[i].weight;
+	}
+	else
+	{
+		for (size_t i = 0; i < mode.simulations.size(); i++)
+			weights[mode.simulations.payouts()[i]]
+				+= mode.simulations.weights()[i];
+	}
+	fillOutcomes(weights, store);
+}
+
+// `weights` maps payouts to their weight.
+void	Distribution::fillOutcomes(std::map<uint64_t, uint64_t> weights,
+		SimulationStore &store)
+{
+	std::map<uint64_t, uint64_t>::iterator	it;
+	size_t									row;
+
+	for (it = weights.begin(); it != weights.end(); )
+	{
+		if (it->second == 0)
+			it = weights.erase(it);
+		else
+			++it;
+	}
+	store.resize(weights.size());
+	row = 0;
+	for (it = weights.begin(); it != weights.end(); ++it, row++)
+	{
+		store.setRow(row, row + 1, it->second, it->first);
+		store.setEventCount(row, roundEvents(it->first, NULL));
+	}
+	store.buildEventIndex();
+	for (row = 0; row < store.size(); row++)
+		roundEvents(store.payouts()[row], store.eventSlot(row));
+}
+
 bool	Distribution::exportIndex(const std::string &path) const
 {
 	std::ofstream								file(path);
@@ -353,26 +1114,456 @@ bool	Distribution::exportIndex(const std::string &path) const
 	return (true);
 }
 
-bool	Distribution::exportAll(const std::string &outputDir) const
+// Books of `mode` and, with options.dictionarySize, the dictionary trained
+// on them, both as "<file>.tmp". `trained` tells whether there is one.
+bool	Distribution::exportBooks(const std::string &outputDir,
+		const GameMode &mode, const SimulationStore &store,
+		const ExportOptions &options, bool &trained, std::string &error) const
+{
+	std::string	dictionary;
+
+	trained = false;
+	if (options.dictionarySize > 0 && trainDictionary(mode.name, store,
+			options.dictionarySize, options.booksPerFrame > 0
+			? options.booksPerFrame : DICTIONARY_SAMPLE_BOOKS, dictionary))
+	{
+		if (!writeFile(dictionaryPath(outputDir, mode) + ".tmp", dictionary,
+				error))
+			return (false);
+		trained = true;
+	}
+	return (exportJSONLCompressed(booksPath(outputDir, mode) + ".tmp",
+		mode.name, store, options, dictionary, error));
+}
+
+// errors[0] is the lookup table's, errors[1] the books'. When both are
+// empty the "<file>.tmp" of the mode are renamed to their final names;
+// otherwise, or when a rename fails, they are all removed and the errors
+// reported.
+bool	Distribution::commitMode(const std::string &outputDir,
+		const GameMode &mode, bool trained, std::string errors[2],
+		bool verbose)
+{
+	const std::string	paths[3] = {lookUpTablePath(outputDir, mode),
+		booksPath(outputDir, mode), dictionaryPath(outputDir, mode)};
+	const size_t		files = trained ? 3 : 2;
+	size_t				committed = 0;
+
+	if (errors[0].empty() && errors[1].empty())
+	{
+		while (committed < files && std::rename((paths[committed]
+				+ ".tmp").c_str(), paths[committed].c_str()) == 0)
+			committed++;
+		if (committed < files)
+			errors[committed > 0] = "cannot rename to " + paths[committed];
+	}
+	if (!errors[0].empty() || !errors[1].empty())
+	{
+		for (size_t f = 0; f < 3; f++)
+			std::remove((paths[f] + ".tmp").c_str());
+		for (size_t f = 0; f < committed; f++)
+			std::remove(paths[f].c_str());
+		for (size_t t = 0; t < 2; t++)
+		{
+			if (!errors[t].empty())
+				std::cerr << "Error: mode '" << mode.name << "': "
+						  << errors[t] << std::endl;
+		}
+		return (false);
+	}
+	// A dictionary left by an earlier export would not match
+	if (!trained)
+		std::remove(paths[2].c_str());
+	if (!verbose)
+		return (true);
+	std::cout << "  Mode '" << mode.name << "':" << std::endl;
+	std::cout << "    CSV: " << paths[0] << std::endl;
+	std::cout << "    JSONL: " << paths[1] << std::endl;
+	if (trained)
+		std::cout << "    Dictionary: " << paths[2] << std::endl;
+	return (true);
+}
+
+// Every mode contributes two independent tasks (lookup table, books and
+// their dictionary) that write to "<file>.tmp". Once all tasks are done, a
+// mode whose files all succeeded is committed by renaming them; a failing
+// mode has its temporaries removed and its errors reported. index.json is
+// written last, only when every mode made it. Up to one books file per
+// thread is compressed at once, so the zstd workers are split between them.
+bool	Distribution::exportAll(const std::string &outputDir,
+		const ExportOptions &options) const
 {
 	std::map<std::string, GameMode>::const_iterator	it;
-	std::string										csvPath;
-	std::string										jsonlPath;
+	std::vector<const GameMode *>					modes;
+	std::vector<SimulationStore>					aggregated;
+	std::vector<std::string>						errors;
+	std::vector<char>								trained;
+	std::unique_ptr<ThreadPool>						pool;
+	ExportOptions									shared;
+	size_t											tasks;
+	size_t											threads;
+	bool											ok;
 
 	for (it = _modes.begin(); it != _modes.end(); ++it)
+		modes.push_back(&it->second);
+	tasks = modes.size() * 2;
+	threads = std::min(ThreadPool::resolveThreads(options.threads), tasks);
+	shared = options;
+	shared.compression = options.compression.splitAcross(
+		std::min(threads, modes.size()));
+	errors.resize(tasks);
+	trained.assign(modes.size(), 0);
+	if (options.lookup != LOOKUP_ROUNDS)
+	{
+		aggregated.resize(modes.size());
+		for (size_t m = 0; m < modes.size(); m++)
+			aggregateOutcomes(*modes[m], options.lookup, aggregated[m]);
+	}
+
+	auto	runTask = [&](size_t task) {
+		const GameMode			&mode = *modes[task / 2];
+		const SimulationStore	&store = aggregated.empty()
+			? mode.simulations : aggregated[task / 2];
+		bool					dictionary;
+
+		if (isCancelled(shared.cancel))
+			errors[task] = "cancelled";
+		else if (task % 2 == 0)
+			exportCSV(lookUpTablePath(outputDir, mode) + ".tmp", mode.name,
+				store, shared, errors[task]);
+		else
+		{
+			exportBooks(outputDir, mode, store, shared, dictionary,
+				errors[task]);
+			trained[task / 2] = dictionary;
+		}
+	};
+
+	if (threads > 1)
+	{
+		pool.reset(new ThreadPool(threads));
+		for (size_t task = 0; task < tasks; task++)
+			pool->submit([&runTask, task]() { runTask(task); });
+		pool->wait();
+	}
+	else
 	{
-		csvPath = outputDir + "/lookUpTable_" + it->second.name + "_0.csv";
-		jsonlPath = outputDir + "/books_" + it->second.name + ".jsonl.zst";
-		if (!exportCSV(csvPath, it->second))
+		for (size_t task = 0; task < tasks; task++)
+			runTask(task);
+	}
+	ok = true;
+	for (size_t m = 0; m < modes.size(); m++)
+	{
+		if (!commitMode(outputDir, *modes[m], trained[m], &errors[2 * m],
+				options.verbose))
+			ok = false;
+	}
+	if (!ok)
+	{
+		std::cerr << "Error: export incomplete, index.json not written"
+				  << std::endl;
+		return (false);
+	}
+	if (!exportIndex(outputDir + "/index.json"))
+		return (false);
+	if (options.verbose)
+		std::cout << "  Index: " << outputDir << "/index.json" << std::endl;
+	return (true);
+}
+
+// Producer side of streamSimulations: generates block slot.index into the
+// slot and takes its statistics. With a rounds lookup table it also fills
+// the events and formats the books (noting where frames end) and the CSV
+// rows, so consumers only compress and write.
+void	Distribution::streamBlock(const GameMode &mode, StreamBlock &slot,
+		size_t count, uint64_t seed, const SimulationOptions &simulation,
+		const ExportOptions &exporting, LiveStatistics &live) const
+{
+	const size_t	first = slot.index * BLOCK_SIZE;
+	const size_t	rows = std::min(first + BLOCK_SIZE, count) - first;
+	PayoutMoments	moments;
+
+	slot.store.resize(rows);
+	slot.books.clear();
+	slot.frameEnds.clear();
+	slot.lookup.clear();
+	simulateBlock(mode, slot.store, first, slot.index, seed,
+		simulation.engine);
+	{
+		ScopedTimer	timer(mode.name, PROFILE_STATISTICS);
+
+		moments.add(slot.store, 0, rows);
+	}
+	live.addBlock(slot.index, moments);
+	if (exporting.lookup != LOOKUP_ROUNDS)
+		return ;
+	slot.store.buildEventIndex();
+	emitBlockEvents(mode, slot.store, 0, rows);
+	{
+		ScopedTimer	timer(mode.name, PROFILE_FORMAT);
+
+		for (size_t i = 0; i < rows; i++)
+		{
+			formatSimulation(slot.books, slot.store, i);
+			slot.books += '\n';
+			if (exporting.booksPerFrame > 0
+				&& (first + i + 1) % exporting.booksPerFrame == 0
+				&& first + i + 1 < count)
+				slot.frameEnds.push_back(slot.books.size());
+		}
+		timer.addBytes(slot.books.size());
+	}
+	ScopedTimer	timer(mode.name, PROFILE_LOOKUP);
+
+	CsvWriter::appendRows(slot.lookup, slot.store, 0, rows);
+	timer.addBytes(slot.lookup.size());
+}
+
+// Books consumer of streamSimulations: compresses the blocks in order into
+// books_<mode>.jsonl.zst.tmp, ending a frame wherever the producer noted
+// one. A dictionary is trained on the first block. Returns false with an
+// empty `error` when the ring was cancelled by someone else.
+bool	Distribution::streamBooks(BlockRing &ring, size_t blocks,
+		const std::string &outputDir, const GameMode &mode,
+		const ExportOptions &options, bool &trained, std::string &error) const
+{
+	ZstdWriter			writer;
+	std::string			dictionary;
+	const StreamBlock	*block;
+	size_t				from;
+	bool				ok;
+
+	trained = false;
+	if (!writer.open(booksPath(outputDir, mode) + ".tmp", options.compression,
+			mode.name))
+	{
+		error = writer.error();
+		return (false);
+	}
+	writer.setSeekable(options.booksPerFrame > 0);
+	for (size_t b = 0; b < blocks; b++)
+	{
+		if (!(block = ring.acquire(b)))
 			return (false);
-		if (!exportJSONLCompressed(jsonlPath, it->second))
+		if (b == 0 && options.dictionarySize > 0 && trainDictionary(mode.name,
+				block->store, options.dictionarySize, options.booksPerFrame > 0
+				? options.booksPerFrame : DICTIONARY_SAMPLE_BOOKS, dictionary))
+		{
+			if (!writeFile(dictionaryPath(outputDir, mode) + ".tmp",
+					dictionary, error))
+				return (false);
+			trained = true;
+			if (!writer.setDictionary(dictionary))
+			{
+				error = writer.error();
+				return (false);
+			}
+		}
+		from = 0;
+		ok = true;
+		for (size_t f = 0; ok && f < block->frameEnds.size(); f++)
+		{
+			ok = writer.write(block->books.data() + from,
+				block->frameEnds[f] - from) && writer.endFrame();
+			from = block->frameEnds[f];
+		}
+		ok = ok && writer.write(block->books.data() + from,
+			block->books.size() - from);
+		addProgress(options.progress, block->store.size());
+		ring.release(b);
+		if (!ok)
+		{
+			error = writer.error();
 			return (false);
-		std::cout << "  Mode '" << it->second.name << "':" << std::endl;
-		std::cout << "    CSV: " << csvPath << std::endl;
-		std::cout << "    JSONL: " << jsonlPath << std::endl;
+		}
 	}
-	if (!exportIndex(outputDir + "/index.json"))
+	if (!writer.close())
+	{
+		error = writer.error();
+		return (false);
+	}
+	return (true);
+}
+
+// Lookup consumer of streamSimulations: appends the CSV rows of the blocks
+// in order. Same contract as streamBooks.
+static bool	streamLookup(BlockRing &ring, size_t blocks,
+		const std::string &path, const std::string &mode, std::string &error)
+{
+	std::ofstream		file(path, std::ios::binary);
+	const StreamBlock	*block;
+
+	if (!file.is_open())
+	{
+		error = "cannot open " + path;
+		return (false);
+	}
+	for (size_t b = 0; b < blocks; b++)
+	{
+		if (!(block = ring.acquire(b)))
+			return (false);
+		{
+			ScopedTimer	timer(mode, PROFILE_LOOKUP);
+
+			file.write(block->lookup.data(), block->lookup.size());
+		}
+		ring.release(b);
+		if (file.fail())
+		{
+			error = "write failed on " + path;
+			return (false);
+		}
+	}
+	file.close();
+	if (file.fail())
+	{
+		error = "write failed on " + path;
 		return (false);
-	std::cout << "  Index: " << outputDir << "/index.json" << std::endl;
+	}
 	return (true);
 }
+
+// runSimulations and exportAll of one mode in a single pass that never
+// holds the whole book, for runs too large for memory. Blocks go through a
+// BlockRing of STREAM_RING_BLOCKS blocks: producers (one per thread, at most
+// one per slot) generate and format blocks in any order, while one consumer
+// compresses the books and another writes the lookup table, both in block
+// order. Memory stays at the ring's blocks whatever `count` and the thread
+// count, and every stage overlaps the others.
+//
+// The files are the ones exportAll would write for the mode, committed the
+// same way; a dictionary is trained on the first block only. Aggregated
+// lookup tables are built from the running counts once every block is
+// through. index.json is left to the caller (exportIndex), and the mode
+// keeps its statistics but no simulations. Only GENERATE_ROUNDS without
+// early stopping streams: other generations need every round first.
+bool	Distribution::streamSimulations(const std::string &mode, size_t count,
+		uint64_t seed, const std::string &outputDir,
+		const SimulationOptions &simulation, const ExportOptions &exporting)
+{
+	std::map<std::string, GameMode>::iterator	it;
+	std::map<uint64_t, uint64_t>				observed;
+	std::mutex									observedMutex;
+	std::atomic<size_t>							nextBlock(0);
+	LiveStatistics								ownLive;
+	LiveStatistics								*live;
+	SimulationStore								aggregated;
+	std::string									errors[2];
+	size_t										blocks;
+	size_t										producers;
+	size_t										consumers;
+	bool										trained;
+
+	it = _modes.find(mode);
+	if (it == _modes.end())
+		return (false);
+	if (simulation.generation != GENERATE_ROUNDS
+		|| simulation.targetHalfWidth > 0.0)
+	{
+		std::cerr << "Error: mode '" << mode << "': streaming needs round"
+				  << " generation without early stopping" << std::endl;
+		return (false);
+	}
+	GameMode	&gameMode = it->second;
+	ScopedTimer	timer(gameMode.name, PROFILE_SIMULATE);
+
+	prepareSampler(gameMode);
+	gameMode.simulations = SimulationStore();
+	gameMode.moments = PayoutMoments();
+	gameMode.stats = ModeStatistics();
+	blocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	producers = std::max<size_t>(1, std::min({
+		ThreadPool::resolveThreads(simulation.threads), blocks,
+		STREAM_RING_BLOCKS}));
+	consumers = exporting.lookup == LOOKUP_ROUNDS ? 2 : 0;
+	live = simulation.live ? simulation.live : &ownLive;
+	live->reset(blocks);
+	trained = false;
+
+	BlockRing	ring(STREAM_RING_BLOCKS, consumers);
+	ThreadPool	pool(producers + consumers);
+
+	if (consumers > 0)
+	{
+		pool.submit([&]() {
+			if (!streamBooks(ring, blocks, outputDir, gameMode, exporting,
+					trained, errors[1]))
+				ring.cancel();
+		});
+		pool.submit([&]() {
+			if (!streamLookup(ring, blocks, lookUpTablePath(outputDir,
+					gameMode) + ".tmp", gameMode.name, errors[0]))
+				ring.cancel();
+		});
+	}
+	for (size_t t = 0; t < producers; t++)
+	{
+		pool.submit([&]() {
+			std::map<uint64_t, uint64_t>			counts;
+			std::map<uint64_t, uint64_t>::iterator	entry;
+			StreamBlock								*slot;
+			size_t									block;
+
+			while ((block = nextBlock++) < blocks)
+			{
+				if (isCancelled(simulation.cancel)
+					|| isCancelled(exporting.cancel))
+					ring.cancel();
+				if (!(slot = ring.reserve(block)))
+					return ;
+				streamBlock(gameMode, *slot, count, seed, simulation,
+					exporting, *live);
+				if (exporting.lookup == LOOKUP_OBSERVED)
+				{
+					for (size_t i = 0; i < slot->store.size(); i++)
+						counts[slot->store.payouts()[i]]++;
+				}
+				addProgress(simulation.progress, slot->store.size());
+				ring.publish(block);
+			}
+			std::lock_guard<std::mutex>	lock(observedMutex);
+
+			for (entry = counts.begin(); entry != counts.end(); ++entry)
+				observed[entry->first] += entry->second;
+		});
+	}
+	pool.wait();
+	if (!ring.cancelled() && consumers == 0)
+	{
+		if (exporting.lookup == LOOKUP_CONFIGURED)
+			aggregateOutcomes(gameMode, exporting.lookup, aggregated);
+		else
+			fillOutcomes(observed, aggregated);
+		exportCSV(lookUpTablePath(outputDir, gameMode) + ".tmp",
+			gameMode.name, aggregated, exporting, errors[0]);
+		exportBooks(outputDir, gameMode, aggregated, exporting, trained,
+			errors[1]);
+	}
+	if (ring.cancelled() && errors[0].empty() && errors[1].empty())
+		errors[1] = "cancelled";
+	Profiler::instance().sampleMemory(gameMode.name);
+	if (!commitMode(outputDir, gameMode, trained, errors, exporting.verbose))
+		return (false);
+	gameMode.moments = live->prefix();
+	gameMode.stats = gameMode.moments.statistics();
+	Profiler::instance().addRounds(gameMode.name, count);
+	return (true);
+}
+
+std::string	Distribution::lookUpTablePath(const std::string &outputDir,
+		const GameMode &mode)
+{
+	return (outputDir + "/lookUpTable_" + mode.name + "_0.csv");
+}
+
+std::string	Distribution::booksPath(const std::string &outputDir,
+		const GameMode &mode)
+{
+	return (outputDir + "/books_" + mode.name + ".jsonl.zst");
+}
+
+std::string	Distribution::dictionaryPath(const std::string &outputDir,
+		const GameMode &mode)
+{
+	return (outputDir + "/books_" + mode.name + ".dict");
+}
@@ -0,0 +1,689 @@
+#include "GameConfig.hpp"
+#include "Json.hpp"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <zstd.h>
+
+GameConfig::GameConfig(void)
+	: streaming(false)
+{
+}
+
+void	GameConfig::build(Distribution &dist) const
+{
+	for (size_t m = 0; m < modes.size(); m++)
+	{
+		dist.addMode(modes[m].name, modes[m].cost);
+		for (size_t i = 0; i < modes[m].multipliers.size(); i++)
+			dist.addMultiplier(modes[m].name,
+				modes[m].multipliers[i].multiplier,
+				modes[m].multipliers[i].weight);
+	}
+}
+
+// Typed accessors: a missing member keeps `out` unchanged and succeeds, a
+// member of the wrong type fails with "<where>.<key>: ..." in `error`.
+static bool	readNumber(const JsonValue &object, const std::string &key,
+		const std::string &where, double &out, std::string &error)
+{
+	const JsonValue	*value = object.find(key);
+
+	if (!value)
+		return (true);
+	if (value->type() != JSON_NUMBER)
+	{
+		error = where + "." + key + ": expected a number";
+		return (false);
+	}
+	out = value->asNumber();
+	return (true);
+}
+
+// Non-negative integer, exact up to 2^53.
+// Counts and weights are integers in [0, 2^53], where doubles are exact.
+static bool	isCount(double number)
+{
+	return (number >= 0.0 && number <= 9007199254740992.0
+		&& number == std::floor(number));
+}
+
+static bool	readCount(const JsonValue &object, const std::string &key,
+		const std::string &where, uint64_t &out, std::string &error)
+{
+	double	number;
+
+	number = static_cast<double>(out);
+	if (!readNumber(object, key, where, number, error))
+		return (false);
+	if (!isCount(number))
+	{
+		error = where + "." + key + ": expected a non-negative integer";
+		return (false);
+	}
+	out = static_cast<uint64_t>(number);
+	return (true);
+}
+
+static bool	readSize(const JsonValue &object, const std::string &key,
+		const std::string &where, size_t &out, std::string &error)
+{
+	uint64_t	value = out;
+
+	if (!readCount(object, key, where, value, error))
+		return (false);
+	out = static_cast<size_t>(value);
+	return (true);
+}
+
+static bool	readBool(const JsonValue &object, const std::string &key,
+		const std::string &where, bool &out, std::string &error)
+{
+	const JsonValue	*value = object.find(key);
+
+	if (!value)
+		return (true);
+	if (value->type() != JSON_BOOL)
+	{
+		error = where + "." + key + ": expected true or false";
+		return (false);
+	}
+	out = value->asBool();
+	return (true);
+}
+
+static bool	readString(const JsonValue &object, const std::string &key,
+		const std::string &where, std::string &out, std::string &error)
+{
+	const JsonValue	*value = object.find(key);
+
+	if (!value)
+		return (true);
+	if (value->type() != JSON_STRING)
+	{
+		error = where + "." + key + ": expected a string";
+		return (false);
+	}
+	out = value->asString();
+	return (true);
+}
+
+// Names end up in file names (books_<mode>.jsonl.zst).
+static bool	isValidName(const std::string &name)
+{
+	if (name.empty() || name == "." || name == "..")
+		return (false);
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		if (name[i] == '/' || name[i] == '\\'
+			|| static_cast<unsigned char>(name[i]) < 0x20)
+			return (false);
+	}
+	return (true);
+}
+
+static bool	parseSimulation(const JsonValue &object, SimulationOptions &options,
+		std::string &error)
+{
+	std::string	engine;
+	std::string	generation;
+
+	if (object.type() != JSON_OBJECT)
+	{
+		error = "simulation: expected an object";
+		return (false);
+	}
+	engine = options.engine == RNG_PHILOX ? "philox" : "mt19937";
+	generation = options.generation == GENERATE_MULTINOMIAL
+		? "multinomial" : "rounds";
+	if (!readSize(object, "threads", "simulation", options.threads, error)
+		|| !readString(object, "engine", "simulation", engine, error)
+		|| !readString(object, "generation", "simulation", generation, error)
+		|| !readBool(object, "shuffle", "simulation", options.shuffle, error)
+		|| !readNumber(object, "targetHalfWidth", "simulation",
+			options.targetHalfWidth, error)
+		|| !readNumber(object, "confidence", "simulation",
+			options.confidence, error))
+		return (false);
+	if (engine == "mt19937")
+		options.engine = RNG_MT19937;
+	else if (engine == "philox")
+		options.engine = RNG_PHILOX;
+	else
+	{
+		error = "simulation.engine: expected \"mt19937\" or \"philox\"";
+		return (false);
+	}
+	if (generation == "rounds")
+		options.generation = GENERATE_ROUNDS;
+	else if (generation == "multinomial")
+		options.generation = GENERATE_MULTINOMIAL;
+	else
+	{
+		error = "simulation.generation: expected \"rounds\" or "
+			"\"multinomial\"";
+		return (false);
+	}
+	if (options.targetHalfWidth < 0.0)
+	{
+		error = "simulation.targetHalfWidth: must not be negative";
+		return (false);
+	}
+	if (options.confidence <= 0.0 || options.confidence >= 1.0)
+	{
+		error = "simulation.confidence: expected a value in (0, 1)";
+		return (false);
+	}
+	return (true);
+}
+
+// Integer in [lower, upper]; `zero` also accepts 0 (a "use the default"
+// value outside the range).
+static bool	readInteger(const JsonValue &object, const std::string &key,
+		const std::string &where, int lower, int upper, bool zero, int &out,
+		std::string &error)
+{
+	double	number;
+
+	number = out;
+	if (!readNumber(object, key, where, number, error))
+		return (false);
+	if (number != std::floor(number)
+		|| ((number < lower || number > upper) && !(zero && number == 0.0)))
+	{
+		error = where + "." + key + ": expected " + (zero ? "0 or " : "")
+			+ "an integer in [" + std::to_string(lower) + ", "
+			+ std::to_string(upper) + "]";
+		return (false);
+	}
+	out = static_cast<int>(number);
+	return (true);
+}
+
+// A zstd parameter within the bounds of the linked libzstd.
+static bool	readZstdParameter(const JsonValue &object, const std::string &key,
+		ZSTD_cParameter parameter, bool zero, int &out, std::string &error)
+{
+	ZSTD_bounds	bounds = ZSTD_cParam_getBounds(parameter);
+
+	if (ZSTD_isError(bounds.error))
+	{
+		error = "export.compression." + key + ": not supported by libzstd";
+		return (false);
+	}
+	return (readInteger(object, key, "export.compression", bounds.lowerBound,
+		bounds.upperBound, zero, out, error));
+}
+
+// "compression" is a preset name ("default", "fast", "small") or an object
+// overriding the default settings field by field.
+static bool	parseCompression(const JsonValue &value,
+		CompressionSettings &settings, std::string &error)
+{
+	// A libzstd without multithreading reports [0, 0] workers; ZstdWriter
+	// then compresses on the caller, so accept what a threaded build would
+	static const int	MAX_WORKERS = 256;
+	ZSTD_bounds			workers = ZSTD_cParam_getBounds(ZSTD_c_nbWorkers);
+
+	if (value.type() == JSON_STRING)
+	{
+		if (value.asString() == "default")
+			settings = CompressionSettings();
+		else if (value.asString() == "fast")
+			settings = CompressionSettings::fast();
+		else if (value.asString() == "small")
+			settings = CompressionSettings::small();
+		else
+		{
+			error = "export.compression: unknown preset \""
+				+ value.asString() + "\"";
+			return (false);
+		}
+		return (true);
+	}
+	if (value.type() != JSON_OBJECT)
+	{
+		error = "export.compression: expected a preset name or an object";
+		return (false);
+	}
+	return (readZstdParameter(value, "level", ZSTD_c_compressionLevel, false,
+			settings.level, error)
+		&& readInteger(value, "workers", "export.compression", 0,
+			ZSTD_isError(workers.error) || workers.upperBound == 0
+			? MAX_WORKERS : workers.upperBound, false, settings.workers, error)
+		&& readBool(value, "longDistance", "export.compression",
+			settings.longDistance, error)
+		&& readZstdParameter(value, "windowLog", ZSTD_c_windowLog, true,
+			settings.windowLog, error));
+}
+
+static bool	parseExport(const JsonValue &object, ExportOptions &options,
+		std::string &error)
+{
+	const JsonValue	*compression;
+	std::string		lookup;
+
+	if (object.type() != JSON_OBJECT)
+	{
+		error = "export: expected an object";
+		return (false);
+	}
+	compression = object.find("compression");
+	if (compression && !parseCompression(*compression, options.compression,
+			error))
+		return (false);
+	lookup = "rounds";
+	if (!readString(object, "lookup", "export", lookup, error)
+		|| !readSize(object, "csvThreads", "export", options.csvThreads,
+			error)
+		|| !readBool(object, "preallocate", "export", options.preallocate,
+			error)
+		|| !readSize(object, "threads", "export", options.threads, error)
+		|| !readSize(object, "booksPerFrame", "export",
+			options.booksPerFrame, error)
+		|| !readSize(object, "dictionarySize", "export",
+			options.dictionarySize, error))
+		return (false);
+	if (lookup == "rounds")
+		options.lookup = LOOKUP_ROUNDS;
+	else if (lookup == "configured")
+		options.lookup = LOOKUP_CONFIGURED;
+	else if (lookup == "observed")
+		options.lookup = LOOKUP_OBSERVED;
+	else
+	{
+		error = "export.lookup: expected \"rounds\", \"configured\" or "
+			"\"observed\"";
+		return (false);
+	}
+	return (true);
+}
+
+// An axis lists its "values", or spans "from" to "to" by "step".
+static bool	parseAxis(const JsonValue &object, const std::string &where,
+		SweepAxis &axis, std::string &error)
+{
+	const JsonValue	*values;
+	std::string		field;
+	size_t			row;
+	double			from;
+	double			to;
+	double			step;
+
+	if (object.type() != JSON_OBJECT)
+	{
+		error = where + ": expected an object";
+		return (false);
+	}
+	row = 0;
+	field = "weight";
+	if (!object.find("row"))
+	{
+		error = where + ".row: missing";
+		return (false);
+	}
+	if (!readSize(object, "row", where, row, error)
+		|| !readString(object, "field", where, field, error))
+		return (false);
+	if (field != "weight" && field != "multiplier")
+	{
+		error = where + ".field: expected \"weight\" or \"multiplier\"";
+		return (false);
+	}
+	values = object.find("values");
+	if (values)
+	{
+		std::vector<double>	grid;
+
+		if (values->type() != JSON_ARRAY)
+		{
+			error = where + ".values: expected an array of numbers";
+			return (false);
+		}
+		for (size_t i = 0; i < values->asArray().size(); i++)
+		{
+			if (values->asArray()[i].type() != JSON_NUMBER)
+			{
+				error = where + ".values: expected an array of numbers";
+				return (false);
+			}
+			grid.push_back(values->asArray()[i].asNumber());
+		}
+		axis = SweepAxis::grid(row, field == "weight" ? SWEEP_WEIGHT
+			: SWEEP_MULTIPLIER, grid);
+		return (true);
+	}
+	from = 0.0;
+	to = -1.0;
+	step = field == "weight" ? 1.0 : 0.1;
+	if (!object.find("from") || !object.find("to"))
+	{
+		error = where + ": expected \"values\" or \"from\" and \"to\"";
+		return (false);
+	}
+	if (!readNumber(object, "from", where, from, error)
+		|| !readNumber(object, "to", where, to, error)
+		|| !readNumber(object, "step", where, step, error))
+		return (false);
+	if (!(step > 0.0) || to < from)
+	{
+		error = where + ": expected from <= to and a positive step";
+		return (false);
+	}
+	axis = SweepAxis::range(row, field == "weight" ? SWEEP_WEIGHT
+		: SWEEP_MULTIPLIER, from, to, step);
+	return (true);
+}
+
+static bool	parseSweep(const JsonValue &object, SweepConfig &sweep,
+		std::string &error)
+{
+	const JsonValue	*axes;
+
+	if (object.type() != JSON_OBJECT)
+	{
+		error = "sweep: expected an object";
+		return (false);
+	}
+	if (!readString(object, "mode", "sweep", sweep.mode, error)
+		|| !readSize(object, "threads", "sweep", sweep.options.threads, error)
+		|| !readCount(object, "simulations", "sweep",
+			sweep.options.simulations, error)
+		|| !readCount(object, "seed", "sweep", sweep.options.seed, error))
+		return (false);
+	if (sweep.mode.empty())
+	{
+		error = "sweep.mode: missing";
+		return (false);
+	}
+	axes = object.find("axes");
+	if (!axes || axes->type() != JSON_ARRAY)
+	{
+		error = "sweep.axes: expected an array";
+		return (false);
+	}
+	sweep.axes.resize(axes->asArray().size());
+	for (size_t a = 0; a < sweep.axes.size(); a++)
+	{
+		if (!parseAxis(axes->asArray()[a], "sweep.axes["
+				+ std::to_string(a) + "]", sweep.axes[a], error))
+			return (false);
+	}
+	return (true);
+}
+
+static bool	parseSolver(const JsonValue &object, const std::string &where,
+		ModeConfig &mode, std::string &error)
+{
+	const JsonValue	*fixed;
+
+	if (object.type() != JSON_OBJECT)
+	{
+		error = where + ": expected an object";
+		return (false);
+	}
+	if (!object.find("rtp"))
+	{
+		error = where + ".rtp: missing";
+		return (false);
+	}
+	mode.solve = true;
+	mode.verifyConfidence = 0.9999;
+	if (!readNumber(object, "rtp", where, mode.solver.rtp, error)
+		|| !readNumber(object, "hitFrequency", where,
+			mode.solver.hitFrequency, error)
+		|| !readNumber(object, "volatility", where, mode.solver.volatility,
+			error)
+		|| !readCount(object, "totalWeight", where, mode.solver.totalWeight,
+			error)
+		|| !readCount(object, "minWeight", where, mode.solver.minWeight,
+			error)
+		|| !readNumber(object, "tolerance", where, mode.solver.tolerance,
+			error)
+		|| !readNumber(object, "verifyConfidence", where,
+			mode.verifyConfidence, error))
+		return (false);
+	if (mode.verifyConfidence < 0.0 || mode.verifyConfidence >= 1.0)
+	{
+		error = where + ".verifyConfidence: expected a value in [0, 1)";
+		return (false);
+	}
+	fixed = object.find("fixed");
+	if (!fixed)
+		return (true);
+	if (fixed->type() != JSON_ARRAY)
+	{
+		error = where + ".fixed: expected an array of row indices";
+		return (false);
+	}
+	for (size_t i = 0; i < fixed->asArray().size(); i++)
+	{
+		const JsonValue	&row = fixed->asArray()[i];
+
+		if (row.type() != JSON_NUMBER || row.asNumber() < 0.0
+			|| row.asNumber() != std::floor(row.asNumber()))
+		{
+			error = where + ".fixed: expected an array of row indices";
+			return (false);
+		}
+		mode.solver.fixedRows.push_back(static_cast<size_t>(row.asNumber()));
+	}
+	return (true);
+}
+
+// A multiplier is [multiplier, weight] or {"multiplier": m, "weight": w}.
+static bool	parseMultiplier(const JsonValue &value, const std::string &where,
+		MultiplierConfig &config, std::string &error)
+{
+	const std::vector<JsonValue>	*pair;
+
+	config.multiplier = -1.0;
+	config.weight = 0;
+	config.payout = 0;
+	if (value.type() == JSON_ARRAY)
+	{
+		pair = &value.asArray();
+		if (pair->size() != 2 || (*pair)[0].type() != JSON_NUMBER
+			|| (*pair)[1].type() != JSON_NUMBER)
+		{
+			error = where + ": expected [multiplier, weight]";
+			return (false);
+		}
+		config.multiplier = (*pair)[0].asNumber();
+		if (!isCount((*pair)[1].asNumber()))
+		{
+			error = where + ": weight must be a non-negative integer";
+			return (false);
+		}
+		config.weight = static_cast<uint64_t>((*pair)[1].asNumber());
+	}
+	else if (value.type() == JSON_OBJECT)
+	{
+		if (!readNumber(value, "multiplier", where, config.multiplier, error)
+			|| !readCount(value, "weight", where, config.weight, error))
+			return (false);
+	}
+	else
+	{
+		error = where + ": expected [multiplier, weight]";
+		return (false);
+	}
+	if (!(config.multiplier >= 0.0))
+	{
+		error = where + ": multiplier must be a non-negative number";
+		return (false);
+	}
+	return (true);
+}
+
+static bool	parseMode(const JsonValue &object, size_t index,
+		uint64_t gameSeed, size_t gameSimulations, ModeConfig &mode,
+		std::string &error)
+{
+	std::string		where;
+	const JsonValue	*multipliers;
+	uint64_t		totalWeight;
+
+	where = "modes[" + std::to_string(index) + "]";
+	if (object.type() != JSON_OBJECT)
+	{
+		error = where + ": expected an object";
+		return (false);
+	}
+	mode.cost = 1.0;
+	mode.seed = gameSeed + index;
+	mode.simulations = gameSimulations;
+	mode.solve = false;
+	mode.verifyConfidence = 0.0;
+	if (!readString(object, "name", where, mode.name, error)
+		|| !readNumber(object, "cost", where, mode.cost, error)
+		|| !readCount(object, "seed", where, mode.seed, error)
+		|| !readSize(object, "simulations", where, mode.simulations, error))
+		return (false);
+	if (!isValidName(mode.name))
+	{
+		error = where + ".name: expected a file-name-safe string";
+		return (false);
+	}
+	if (!(mode.cost > 0.0))
+	{
+		error = where + ".cost: must be positive";
+		return (false);
+	}
+	if (mode.simulations == 0)
+	{
+		error = where + ".simulations: must be positive";
+		return (false);
+	}
+	multipliers = object.find("multipliers");
+	if (!multipliers || multipliers->type() != JSON_ARRAY
+		|| multipliers->asArray().empty())
+	{
+		error = where + ".multipliers: expected a non-empty array";
+		return (false);
+	}
+	mode.multipliers.resize(multipliers->asArray().size());
+	totalWeight = 0;
+	for (size_t i = 0; i < mode.multipliers.size(); i++)
+	{
+		if (!parseMultiplier(multipliers->asArray()[i],
+				where + ".multipliers[" + std::to_string(i) + "]",
+				mode.multipliers[i], error))
+			return (false);
+		totalWeight += mode.multipliers[i].weight;
+	}
+	if (object.find("solver") && !parseSolver(*object.find("solver"),
+			where + ".solver", mode, error))
+		return (false);
+	// A solver keeping the current total would have nothing to spread
+	if (totalWeight == 0 && (!mode.solve || mode.solver.totalWeight == 0))
+	{
+		error = where + " ('" + mode.name + "').multipliers: every weight is 0";
+		return (false);
+	}
+	return (true);
+}
+
+bool	GameConfig::parse(const std::string &text, GameConfig &config,
+		std::string &error)
+{
+	JsonValue		root;
+	const JsonValue	*section;
+	uint64_t		seed;
+	size_t			simulations;
+
+	if (!JsonValue::parse(text, root, error))
+		return (false);
+	if (root.type() != JSON_OBJECT)
+	{
+		error = "expected an object at the top level";
+		return (false);
+	}
+	seed = 42;
+	simulations = 100000;
+	if (!readString(root, "name", "", config.name, error)
+		|| !readString(root, "output", "", config.outputDir, error)
+		|| !readCount(root, "seed", "", seed, error)
+		|| !readSize(root, "simulations", "", simulations, error)
+		|| !readBool(root, "streaming", "", config.streaming, error))
+		return (false);
+	if (!config.name.empty() && !isValidName(config.name))
+	{
+		error = ".name: expected a file-name-safe string";
+		return (false);
+	}
+	section = root.find("simulation");
+	if (section && !parseSimulation(*section, config.simulation, error))
+		return (false);
+	section = root.find("export");
+	if (section && !parseExport(*section, config.exporting, error))
+		return (false);
+	if (config.streaming && (config.simulation.generation != GENERATE_ROUNDS
+		|| config.simulation.targetHalfWidth > 0.0))
+	{
+		error = ".streaming: needs simulation.generation \"rounds\" and no "
+			"simulation.targetHalfWidth";
+		return (false);
+	}
+	section = root.find("sweep");
+	if (section && !parseSweep(*section, config.sweep, error))
+		return (false);
+	section = root.find("modes");
+	if (!section || section->type() != JSON_ARRAY
+		|| section->asArray().empty())
+	{
+		error = "modes: expected a non-empty array";
+		return (false);
+	}
+	config.modes.resize(section->asArray().size());
+	for (size_t m = 0; m < config.modes.size(); m++)
+	{
+		if (!parseMode(section->asArray()[m], m, seed, simulations,
+				config.modes[m], error))
+			return (false);
+		for (size_t other = 0; other < m; other++)
+		{
+			if (config.modes[other].name == config.modes[m].name)
+			{
+				error = "modes[" + std::to_string(m) + "].name: duplicate \""
+					+ config.modes[m].name + "\"";
+				return (false);
+			}
+		}
+	}
+	return (true);
+}
+
+// Errors are prefixed with the file path. The game name defaults to the
+// file name without its extension.
+bool	GameConfig::load(const std::string &path, GameConfig &config,
+		std::string &error)
+{
+	std::ifstream		file(path);
+	std::ostringstream	text;
+	size_t				slash;
+	size_t				dot;
+
+	config = GameConfig();
+	config.path = path;
+	if (!file.is_open())
+	{
+		error = path + ": cannot open";
+		return (false);
+	}
+	text << file.rdbuf();
+	if (!parse(text.str(), config, error))
+	{
+		error = path + ": " + error;
+		return (false);
+	}
+	if (config.name.empty())
+	{
+		slash = path.find_last_of('/');
+		config.name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+		dot = config.name.find_last_of('.');
+		if (dot != std::string::npos && dot > 0)
+			config.name.erase(dot);
+	}
+	return (true);
+}
@@ -0,0 +1,369 @@
+#include "Json.hpp"
+#include <cctype>
+#include <charconv>
+#include <cstring>
+
+JsonValue::JsonValue(void)
+	: _type(JSON_NULL), _bool(false), _number(0.0)
+{
+}
+
+JsonValue::~JsonValue(void)
+{
+}
+
+JsonType	JsonValue::type(void) const
+{
+	return (_type);
+}
+
+bool	JsonValue::asBool(void) const
+{
+	return (_bool);
+}
+
+double	JsonValue::asNumber(void) const
+{
+	return (_number);
+}
+
+const std::string	&JsonValue::asString(void) const
+{
+	return (_string);
+}
+
+const std::vector<JsonValue>	&JsonValue::asArray(void) const
+{
+	return (_array);
+}
+
+// Member `key` of an object, or NULL (also when this is not an object).
+const JsonValue	*JsonValue::find(const std::string &key) const
+{
+	for (size_t i = 0; i < _object.size(); i++)
+	{
+		if (_object[i].first == key)
+			return (&_object[i].second);
+	}
+	return (NULL);
+}
+
+// Recursive descent over the whole text; errors carry the line number.
+class JsonParser
+{
+	public:
+		JsonParser(const std::string &text);
+
+		bool				parseDocument(JsonValue &value);
+		const std::string	&error(void) const;
+
+	private:
+		static const int	MAX_DEPTH = 256;
+
+		const std::string	&_text;
+		size_t				_pos;
+		int					_depth;
+		std::string			_error;
+
+		bool	parseValue(JsonValue &value);
+		bool	parseObject(JsonValue &value);
+		bool	parseArray(JsonValue &value);
+		bool	parseString(std::string &out);
+		bool	parseNumber(JsonValue &value);
+		bool	parseHex4(unsigned int &code);
+		bool	parseLiteral(const char *literal);
+		void	skipWhitespace(void);
+		bool	fail(const std::string &message);
+};
+
+JsonParser::JsonParser(const std::string &text)
+	: _text(text), _pos(0), _depth(0)
+{
+}
+
+const std::string	&JsonParser::error(void) const
+{
+	return (_error);
+}
+
+bool	JsonParser::parseDocument(JsonValue &value)
+{
+	if (!parseValue(value))
+		return (false);
+	skipWhitespace();
+	if (_pos != _text.size())
+		return (fail("unexpected data after the document"));
+	return (true);
+}
+
+bool	JsonParser::parseValue(JsonValue &value)
+{
+	skipWhitespace();
+	if (_pos >= _text.size())
+		return (fail("unexpected end of input"));
+	switch (_text[_pos])
+	{
+		case '{':
+			return (parseObject(value));
+		case '[':
+			return (parseArray(value));
+		case '"':
+			value._type = JSON_STRING;
+			return (parseString(value._string));
+		case 't':
+			value._type = JSON_BOOL;
+			value._bool = true;
+			return (parseLiteral("true"));
+		case 'f':
+			value._type = JSON_BOOL;
+			value._bool = false;
+			return (parseLiteral("false"));
+		case 'n':
+			value._type = JSON_NULL;
+			return (parseLiteral("null"));
+		default:
+			return (parseNumber(value));
+	}
+}
+
+bool	JsonParser::parseObject(JsonValue &value)
+{
+	if (++_depth > MAX_DEPTH)
+		return (fail("nesting too deep"));
+	value._type = JSON_OBJECT;
+	_pos++;
+	skipWhitespace();
+	if (_pos < _text.size() && _text[_pos] == '}')
+	{
+		_pos++;
+		_depth--;
+		return (true);
+	}
+	while (true)
+	{
+		std::pair<std::string, JsonValue>	member;
+
+		skipWhitespace();
+		if (_pos >= _text.size() || _text[_pos] != '"')
+			return (fail("expected a member name"));
+		if (!parseString(member.first))
+			return (false);
+		skipWhitespace();
+		if (_pos >= _text.size() || _text[_pos] != ':')
+			return (fail("expected ':'"));
+		_pos++;
+		if (!parseValue(member.second))
+			return (false);
+		value._object.push_back(member);
+		skipWhitespace();
+		if (_pos < _text.size() && _text[_pos] == ',')
+		{
+			_pos++;
+			continue ;
+		}
+		if (_pos < _text.size() && _text[_pos] == '}')
+			break ;
+		return (fail("expected ',' or '}'"));
+	}
+	_pos++;
+	_depth--;
+	return (true);
+}
+
+bool	JsonParser::parseArray(JsonValue &value)
+{
+	if (++_depth > MAX_DEPTH)
+		return (fail("nesting too deep"));
+	value._type = JSON_ARRAY;
+	_pos++;
+	skipWhitespace();
+	if (_pos < _text.size() && _text[_pos] == ']')
+	{
+		_pos++;
+		_depth--;
+		return (true);
+	}
+	while (true)
+	{
+		value._array.push_back(JsonValue());
+		if (!parseValue(value._array.back()))
+			return (false);
+		skipWhitespace();
+		if (_pos < _text.size() && _text[_pos] == ',')
+		{
+			_pos++;
+			continue ;
+		}
+		if (_pos < _text.size() && _text[_pos] == ']')
+			break ;
+		return (fail("expected ',' or ']'"));
+	}
+	_pos++;
+	_depth--;
+	return (true);
+}
+
+static void	appendUtf8(std::string &out, unsigned int code)
+{
+	if (code < 0x80)
+		out += static_cast<char>(code);
+	else if (code < 0x800)
+	{
+		out += static_cast<char>(0xC0 | (code >> 6));
+		out += static_cast<char>(0x80 | (code & 0x3F));
+	}
+	else if (code < 0x10000)
+	{
+		out += static_cast<char>(0xE0 | (code >> 12));
+		out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+		out += static_cast<char>(0x80 | (code & 0x3F));
+	}
+	else
+	{
+		out += static_cast<char>(0xF0 | (code >> 18));
+		out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+		out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+		out += static_cast<char>(0x80 | (code & 0x3F));
+	}
+}
+
+bool	JsonParser::parseHex4(unsigned int &code)
+{
+	code = 0;
+	for (int i = 0; i < 4; i++, _pos++)
+	{
+		char	c = _pos < _text.size() ? _text[_pos] : '\0';
+
+		code <<= 4;
+		if (c >= '0' && c <= '9')
+			code |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			code |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			code |= c - 'A' + 10;
+		else
+			return (fail("invalid \\u escape"));
+	}
+	return (true);
+}
+
+bool	JsonParser::parseString(std::string &out)
+{
+	unsigned int	code;
+	unsigned int	low;
+	char			c;
+
+	_pos++;
+	while (_pos < _text.size() && _text[_pos] != '"')
+	{
+		c = _text[_pos++];
+		if (static_cast<unsigned char>(c) < 0x20)
+			return (fail("control character in string"));
+		if (c != '\\')
+		{
+			out += c;
+			continue ;
+		}
+		if (_pos >= _text.size())
+			break ;
+		c = _text[_pos++];
+		switch (c)
+		{
+			case '"': out += '"'; break ;
+			case '\\': out += '\\'; break ;
+			case '/': out += '/'; break ;
+			case 'b': out += '\b'; break ;
+			case 'f': out += '\f'; break ;
+			case 'n': out += '\n'; break ;
+			case 'r': out += '\r'; break ;
+			case 't': out += '\t'; break ;
+			case 'u':
+				if (!parseHex4(code))
+					return (false);
+				if (code >= 0xD800 && code < 0xDC00
+					&& _text.compare(_pos, 2, "\\u") == 0)
+				{
+					_pos += 2;
+					if (!parseHex4(low))
+						return (false);
+					if (low < 0xDC00 || low >= 0xE000)
+						return (fail("invalid surrogate pair"));
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(out, code);
+				break ;
+			default:
+				return (fail("invalid escape in string"));
+		}
+	}
+	if (_pos >= _text.size())
+		return (fail("unterminated string"));
+	_pos++;
+	return (true);
+}
+
+bool	JsonParser::parseNumber(JsonValue &value)
+{
+	size_t				start;
+	std::from_chars_result	result;
+
+	start = _pos;
+	if (_pos < _text.size() && _text[_pos] == '-')
+		_pos++;
+	if (_pos >= _text.size() || !isdigit(_text[_pos]))
+		return (fail("unexpected character"));
+	if (_text[_pos] == '0' && _pos + 1 < _text.size()
+		&& isdigit(_text[_pos + 1]))
+		return (fail("leading zero in number"));
+	while (_pos < _text.size() && (isdigit(_text[_pos])
+			|| strchr(".eE+-", _text[_pos])))
+		_pos++;
+	value._type = JSON_NUMBER;
+	result = std::from_chars(_text.data() + start, _text.data() + _pos,
+		value._number);
+	if (result.ec != std::errc() || result.ptr != _text.data() + _pos)
+		return (fail("invalid number"));
+	return (true);
+}
+
+bool	JsonParser::parseLiteral(const char *literal)
+{
+	size_t	length = strlen(literal);
+
+	if (_text.compare(_pos, length, literal) != 0)
+		return (fail("unexpected character"));
+	_pos += length;
+	return (true);
+}
+
+void	JsonParser::skipWhitespace(void)
+{
+	while (_pos < _text.size() && (_text[_pos] == ' ' || _text[_pos] == '\t'
+			|| _text[_pos] == '\n' || _text[_pos] == '\r'))
+		_pos++;
+}
+
+bool	JsonParser::fail(const std::string &message)
+{
+	size_t	line;
+
+	line = 1;
+	for (size_t i = 0; i < _pos && i < _text.size(); i++)
+		line += (_text[i] == '\n');
+	_error = "line " + std::to_string(line) + ": " + message;
+	return (false);
+}
+
+bool	JsonValue::parse(const std::string &text, JsonValue &value,
+		std::string &error)
+{
+	JsonParser	parser(text);
+
+	value = JsonValue();
+	if (!parser.parseDocument(value))
+	{
+		error = parser.error();
+		return (false);
+	}
+	return (true);
+}
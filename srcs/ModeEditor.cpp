@@ -1,11 +1,12 @@
 #include "ModeEditor.hpp"
 #include "imgui.h"
+#include <cstdio>
 #include <cstring>
 #include <cmath>
 #include <algorithm>
 
 ModeEditor::ModeEditor(void)
-	: _numSimulations(100000), _exported(false), _isSimulating(false)
+	: _numSimulations(100000), _exported(false)
 {
 	strncpy(_outputDir, "output", sizeof(_outputDir));
 }
@@ -26,11 +27,14 @@ void	ModeEditor::render(ModeManager &modeManager, GLFWwindow *window)
 	if (ImGui::Button("X", ImVec2(25, 25)))
 		glfwSetWindowShouldClose(window, true);
 
+	pollJob(modeManager);
 	renderHeader();
 	ImGui::Separator();
+	ImGui::BeginDisabled(modeManager.runningJob() != JOB_NONE);
 	renderSettings();
 	ImGui::Separator();
 	renderModesList(modeManager);
+	ImGui::EndDisabled();
 	ImGui::Separator();
 	renderActions(modeManager);
 	renderStatus();
@@ -51,6 +55,8 @@ void	ModeEditor::renderModePanel(ModeEntry &mode, int index)
 	ImGui::PushID(index);
 
 	float	rtpPercent = mode.rtp * 100.0f;
+	if (!mode.simulated)
+		rtpPercent = ModeManager::analyze(mode).stats.rtp * 100.0f;
 	ImVec4	rtpColor;
 	if (rtpPercent < 90.0f)
 		rtpColor = ImVec4(1.0f, 0.3f, 0.3f, 1.0f);
@@ -72,7 +78,7 @@ void	ModeEditor::renderModePanel(ModeEntry &mode, int index)
 	}
 	else
 	{
-		ImGui::TextDisabled("RTP: --");
+		ImGui::TextColored(rtpColor, "Exact: %.2f%%", rtpPercent);
 	}
 
 	if (isOpen)
@@ -212,6 +218,12 @@ void	ModeEditor::renderActions(ModeManager &modeManager)
 	ImGui::TextColored(ImVec4(0.4f, 0.8f, 1.0f, 1.0f), "Actions");
 	ImGui::Spacing();
 
+	if (modeManager.runningJob() != JOB_NONE)
+	{
+		renderJobProgress(modeManager);
+		return ;
+	}
+
 	ImVec4	simBtnColor = ImVec4(0.2f, 0.5f, 0.8f, 1.0f);
 	ImVec4	expBtnColor = ImVec4(0.2f, 0.7f, 0.3f, 1.0f);
 
@@ -220,9 +232,8 @@ void	ModeEditor::renderActions(ModeManager &modeManager)
 		ImVec4(0.3f, 0.6f, 0.9f, 1.0f));
 	if (ImGui::Button("Run Simulations", ImVec2(200, 35)))
 	{
-		modeManager.runAllSimulations(_numSimulations);
-		_statusMsg = "Simulations completed! "
-			+ std::to_string(_numSimulations) + " per mode.";
+		modeManager.startSimulations(_numSimulations);
+		_statusMsg.clear();
 		_exported = false;
 	}
 	ImGui::PopStyleColor(2);
@@ -234,15 +245,11 @@ void	ModeEditor::renderActions(ModeManager &modeManager)
 		ImVec4(0.3f, 0.8f, 0.4f, 1.0f));
 	if (ImGui::Button("Export to Stake Engine", ImVec2(200, 35)))
 	{
-		if (modeManager.exportFiles(_outputDir))
-		{
-			_statusMsg = "Exported to " + std::string(_outputDir) + "/";
-			_exported = true;
-		}
+		_exported = false;
+		if (modeManager.startExport(_outputDir))
+			_statusMsg.clear();
 		else
-		{
 			_statusMsg = "Error: Run simulations first!";
-		}
 	}
 	ImGui::PopStyleColor(2);
 
@@ -253,6 +260,41 @@ void	ModeEditor::renderActions(ModeManager &modeManager)
 	}
 }
 
+void	ModeEditor::renderJobProgress(ModeManager &modeManager)
+{
+	float	progress = modeManager.jobProgress();
+	char	overlay[64];
+
+	snprintf(overlay, sizeof(overlay), "%s... %.0f%%",
+		modeManager.runningJob() == JOB_SIMULATE ? "Simulating" : "Exporting",
+		progress * 100.0f);
+	ImGui::ProgressBar(progress, ImVec2(300, 35), overlay);
+	ImGui::SameLine();
+	if (ImGui::Button("Cancel", ImVec2(100, 35)))
+		modeManager.cancelJob();
+}
+
+// Takes over the result of a background job once it is done.
+void	ModeEditor::pollJob(ModeManager &modeManager)
+{
+	bool	succeeded;
+	JobType	finished;
+
+	finished = modeManager.pollJob(succeeded);
+	if (finished == JOB_SIMULATE && succeeded)
+		_statusMsg = "Simulations completed! "
+			+ std::to_string(_numSimulations) + " per mode.";
+	else if (finished == JOB_SIMULATE)
+		_statusMsg = "Simulations cancelled.";
+	else if (finished == JOB_EXPORT && succeeded)
+	{
+		_statusMsg = "Exported to " + std::string(_outputDir) + "/";
+		_exported = true;
+	}
+	else if (finished == JOB_EXPORT)
+		_statusMsg = "Export cancelled or failed.";
+}
+
 void	ModeEditor::renderExportPreview(const ModeManager &modeManager)
 {
 	ImGui::TextColored(ImVec4(0.3f, 1.0f, 0.5f, 1.0f), "Exported Files:");
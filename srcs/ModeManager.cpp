@@ -3,11 +3,16 @@
 #include <sys/stat.h>
 
 ModeManager::ModeManager(void)
+	: _dist(new Distribution()), _job(JOB_NONE), _jobDone(false),
+	  _jobOk(false), _progress(0), _progressTotal(0), _cancel(false)
 {
 }
 
 ModeManager::~ModeManager(void)
 {
+	_cancel = true;
+	if (_worker.joinable())
+		_worker.join();
 }
 
 void	ModeManager::addDefaultMode(void)
@@ -32,41 +37,188 @@ void	ModeManager::removeLastMode(void)
 		_modes.pop_back();
 }
 
-void	ModeManager::runAllSimulations(int numSimulations)
+// Rebuilds `dist` from `modes` and simulates every mode, storing the
+// results back into the entries. Mode i reports its blocks to live[i] when
+// there is one. Returns false when cancelled.
+bool	ModeManager::simulateModes(std::vector<ModeEntry> &modes,
+		Distribution &dist, int numSimulations, SimulationOptions options,
+		const std::vector<std::unique_ptr<LiveStatistics> > &live)
 {
-	_dist = Distribution();
-	for (size_t i = 0; i < _modes.size(); i++)
+	for (size_t i = 0; i < modes.size(); i++)
 	{
-		ModeEntry	&mode = _modes[i];
+		ModeEntry		&mode = modes[i];
+		LiveStatistics	ownLive;
 
-		_dist.addMode(mode.name, mode.cost);
+		options.live = i < live.size() ? live[i].get() : &ownLive;
+
+		dist.addMode(mode.name, mode.cost);
 		for (size_t j = 0; j < mode.multipliers.size(); j++)
 		{
-			_dist.addMultiplier(mode.name,
+			dist.addMultiplier(mode.name,
 				mode.multipliers[j].multiplier,
 				mode.multipliers[j].weight);
 		}
-		_dist.runSimulations(mode.name, numSimulations, 42 + i);
-		mode.rtp = _dist.getRTP(mode.name);
-		mode.simCount = _dist.simulationCount(mode.name);
+		if (!dist.runSimulations(mode.name, numSimulations, 42 + i, options))
+			return (false);
+
+		const ModeStatistics	&stats = dist.getStatistics(mode.name);
+
+		mode.rtp = stats.rtp;
+		mode.simCount = stats.count;
 		mode.simulated = true;
 		mode.stats.calculated = true;
-		mode.stats.meanPayout = _dist.getMeanPayout(mode.name);
-		mode.stats.variance = _dist.getVariance(mode.name);
-		mode.stats.stdDeviation = _dist.getStandardDeviation(mode.name);
-		mode.stats.volatility = _dist.getVolatility(mode.name);
-		mode.stats.hitFrequency = _dist.getHitFrequency(mode.name);
-		mode.stats.minPayout = _dist.getMinPayout(mode.name);
-		mode.stats.maxPayout = _dist.getMaxPayout(mode.name);
+		mode.stats.meanPayout = stats.meanPayout;
+		mode.stats.variance = stats.variance;
+		mode.stats.stdDeviation = stats.stdDeviation;
+		mode.stats.volatility = stats.volatility;
+		mode.stats.hitFrequency = stats.hitFrequency;
+		mode.stats.minPayout = stats.minPayout;
+		mode.stats.maxPayout = stats.maxPayout;
+		mode.exact = dist.analyzeMode(mode.name).stats;
+		mode.convergence = options.live->convergence();
+	}
+	return (true);
+}
+
+void	ModeManager::runAllSimulations(int numSimulations)
+{
+	_dist.reset(new Distribution());
+	simulateModes(_modes, *_dist, numSimulations, SimulationOptions(),
+		std::vector<std::unique_ptr<LiveStatistics> >());
+}
+
+// Exact metrics of the entry as currently edited, without simulating.
+ModeAnalysis	ModeManager::analyze(const ModeEntry &mode)
+{
+	Distribution	dist;
+
+	dist.addMode(mode.name, mode.cost);
+	for (size_t i = 0; i < mode.multipliers.size(); i++)
+	{
+		dist.addMultiplier(mode.name, mode.multipliers[i].multiplier,
+			mode.multipliers[i].weight);
 	}
+	return (dist.analyzeMode(mode.name));
 }
 
 bool	ModeManager::exportFiles(const char *outputDir)
 {
-	if (_dist.modeCount() == 0)
+	ExportOptions	options;
+
+	if (_dist->modeCount() == 0)
+		return (false);
+	mkdir(outputDir, 0755);
+	options.threads = 0;
+	return (_dist->exportAll(outputDir, options));
+}
+
+// Simulates a snapshot of the modes into a fresh Distribution; both replace
+// the current ones in pollJob() once the job is done.
+bool	ModeManager::startSimulations(int numSimulations)
+{
+	if (_job != JOB_NONE)
+		return (false);
+	_pending.reset(new Distribution());
+	_pendingModes = _modes;
+	_live.clear();
+	for (size_t i = 0; i < _modes.size(); i++)
+		_live.push_back(std::unique_ptr<LiveStatistics>(new LiveStatistics()));
+	_progress = 0;
+	_progressTotal = _modes.size() * static_cast<size_t>(numSimulations);
+	_cancel = false;
+	_jobDone = false;
+	_job = JOB_SIMULATE;
+	_worker = std::thread([this, numSimulations]() {
+		SimulationOptions	options;
+
+		options.progress = &_progress;
+		options.cancel = &_cancel;
+		_jobOk = simulateModes(_pendingModes, *_pending, numSimulations,
+			options, _live);
+		_jobDone = true;
+	});
+	return (true);
+}
+
+bool	ModeManager::startExport(const char *outputDir)
+{
+	std::string	dir(outputDir);
+
+	if (_job != JOB_NONE || _dist->modeCount() == 0)
 		return (false);
 	mkdir(outputDir, 0755);
-	return (_dist.exportAll(outputDir));
+	_progress = 0;
+	_progressTotal = 0;
+	for (size_t i = 0; i < _modes.size(); i++)
+		_progressTotal += _dist->simulationCount(_modes[i].name);
+	_cancel = false;
+	_jobDone = false;
+	_job = JOB_EXPORT;
+	_worker = std::thread([this, dir]() {
+		ExportOptions	options;
+
+		options.threads = 0;
+		options.progress = &_progress;
+		options.cancel = &_cancel;
+		_jobOk = _dist->exportAll(dir, options);
+		_jobDone = true;
+	});
+	return (true);
+}
+
+void	ModeManager::cancelJob(void)
+{
+	_cancel = true;
+}
+
+JobType	ModeManager::runningJob(void) const
+{
+	return (_job);
+}
+
+float	ModeManager::jobProgress(void) const
+{
+	if (_progressTotal == 0)
+		return (0.0f);
+	return (static_cast<float>(_progress.load()) / _progressTotal);
+}
+
+// Called by the UI thread every frame. Returns the job that just finished,
+// or JOB_NONE; `succeeded` is false for a failed or cancelled job.
+JobType	ModeManager::pollJob(bool &succeeded)
+{
+	JobType	finished;
+
+	if (_job == JOB_NONE || !_jobDone)
+		return (JOB_NONE);
+	finished = _job;
+	finishJob();
+	succeeded = _jobOk;
+	return (finished);
+}
+
+void	ModeManager::finishJob(void)
+{
+	_worker.join();
+	if (_job == JOB_SIMULATE && _jobOk)
+	{
+		_dist.swap(_pending);
+		_modes.swap(_pendingModes);
+	}
+	_pending.reset();
+	_pendingModes.clear();
+	_live.clear();
+	_job = JOB_NONE;
+}
+
+// RTP convergence of a mode being simulated by the running job, so far.
+bool	ModeManager::liveConvergence(size_t mode,
+		std::vector<ConvergencePoint> &points) const
+{
+	if (_job != JOB_SIMULATE || mode >= _live.size())
+		return (false);
+	points = _live[mode]->convergence();
+	return (!points.empty());
 }
 
 std::vector<ModeEntry>&	ModeManager::getModes(void)
@@ -86,5 +238,5 @@ size_t	ModeManager::getModeCount(void) const
 
 const Distribution&	ModeManager::getDistribution(void) const
 {
-	return (_dist);
+	return (*_dist);
 }
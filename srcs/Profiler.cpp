@@ -0,0 +1,290 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sys/resource.h>
+
+static const char	*PHASE_NAMES[PROFILE_PHASES] = {
+	"simulate", "generate", "statistics", "events",
+	"format", "compress", "write", "lookup", "dictionary"
+};
+
+PhaseCounters::PhaseCounters(void)
+	: calls(0), nanoseconds(0), bytes(0)
+{
+}
+
+ModeProfile::ModeProfile(void)
+	: rounds(0), firstNs(UINT64_MAX), lastNs(0), peakRssKb(0)
+{
+}
+
+// From the first to the last traced span of the mode, gaps included.
+double	ModeProfile::wallSeconds(void) const
+{
+	if (lastNs < firstNs)
+		return (0.0);
+	return ((lastNs - firstNs) / 1e9);
+}
+
+double	ModeProfile::roundsPerSecond(void) const
+{
+	const uint64_t	ns = phases[PROFILE_SIMULATE].nanoseconds;
+
+	return (ns > 0 ? rounds / (ns / 1e9) : 0.0);
+}
+
+uint64_t	ModeProfile::bytesIn(void) const
+{
+	return (phases[PROFILE_COMPRESS].bytes);
+}
+
+uint64_t	ModeProfile::bytesOut(void) const
+{
+	return (phases[PROFILE_WRITE].bytes);
+}
+
+double	ModeProfile::compressionRatio(void) const
+{
+	return (bytesOut() > 0
+		? static_cast<double>(bytesIn()) / bytesOut() : 0.0);
+}
+
+Profiler::Profiler(void)
+	: _enabled(false), _epoch(std::chrono::steady_clock::now()), _dropped(0)
+{
+}
+
+Profiler::~Profiler(void)
+{
+}
+
+Profiler	&Profiler::instance(void)
+{
+	static Profiler	profiler;
+
+	return (profiler);
+}
+
+void	Profiler::enable(bool enabled)
+{
+	_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool	Profiler::enabled(void) const
+{
+	return (_enabled.load(std::memory_order_relaxed));
+}
+
+void	Profiler::reset(void)
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	_index.clear();
+	_modes.clear();
+	_threads.clear();
+	_spans.clear();
+	_dropped = 0;
+}
+
+uint64_t	Profiler::now(void) const
+{
+	return (std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - _epoch).count());
+}
+
+// Caller holds _mutex.
+ModeProfile	&Profiler::profile(const std::string &mode)
+{
+	std::map<std::string, size_t>::iterator	it;
+
+	it = _index.find(mode);
+	if (it != _index.end())
+		return (_modes[it->second]);
+	_index[mode] = _modes.size();
+	_modes.push_back(ModeProfile());
+	_modes.back().name = mode;
+	return (_modes.back());
+}
+
+void	Profiler::record(const std::string &mode, ProfilePhase phase,
+		uint64_t start, uint64_t end, uint64_t bytes, bool trace)
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	ModeProfile					&target = profile(mode);
+	PhaseCounters				&counters = target.phases[phase];
+
+	counters.calls++;
+	counters.nanoseconds += end - start;
+	counters.bytes += bytes;
+	if (!trace)
+		return ;
+	target.firstNs = std::min(target.firstNs, start);
+	target.lastNs = std::max(target.lastNs, end);
+	if (_spans.size() >= MAX_SPANS)
+	{
+		_dropped++;
+		return ;
+	}
+
+	Span	span;
+
+	span.mode = static_cast<uint32_t>(_index[mode]);
+	span.thread = static_cast<uint32_t>(_threads.insert(std::make_pair(
+		std::this_thread::get_id(), _threads.size() + 1)).first->second);
+	span.phase = phase;
+	span.start = start;
+	span.duration = end - start;
+	span.bytes = bytes;
+	_spans.push_back(span);
+}
+
+void	Profiler::addRounds(const std::string &mode, uint64_t rounds)
+{
+	if (!enabled())
+		return ;
+
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	profile(mode).rounds += rounds;
+}
+
+// ru_maxrss is the peak of the whole process so far (KB on Linux).
+void	Profiler::sampleMemory(const std::string &mode)
+{
+	struct rusage	usage;
+
+	if (!enabled() || getrusage(RUSAGE_SELF, &usage) != 0)
+		return ;
+
+	std::lock_guard<std::mutex>	lock(_mutex);
+	ModeProfile					&target = profile(mode);
+
+	target.peakRssKb = std::max(target.peakRssKb, usage.ru_maxrss);
+}
+
+std::vector<ModeProfile>	Profiler::report(void) const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	return (_modes);
+}
+
+void	Profiler::printReport(std::ostream &out) const
+{
+	std::vector<ModeProfile>	modes = report();
+
+	out << "=== Profile ===" << std::endl;
+	if (modes.empty())
+		out << "  (nothing recorded)" << std::endl;
+	for (size_t m = 0; m < modes.size(); m++)
+	{
+		const ModeProfile	&mode = modes[m];
+
+		out << "  " << mode.name << ": " << std::fixed << std::setprecision(1)
+			<< mode.wallSeconds() * 1e3 << "ms wall, " << mode.rounds
+			<< " rounds (" << std::setprecision(2)
+			<< mode.roundsPerSecond() / 1e6 << "M rounds/s), "
+			<< mode.bytesIn() / 1e6 << " MB in, "
+			<< mode.bytesOut() / 1e6 << " MB out (ratio "
+			<< mode.compressionRatio() << "x), peak RSS "
+			<< mode.peakRssKb / 1024.0 << " MB" << std::endl;
+		for (size_t p = 0; p < PROFILE_PHASES; p++)
+		{
+			const PhaseCounters	&counters = mode.phases[p];
+
+			if (counters.calls == 0)
+				continue ;
+			out << "    " << std::left << std::setw(12)
+				<< PHASE_NAMES[p] << std::right << std::setw(10)
+				<< counters.calls << " calls" << std::setw(12)
+				<< std::setprecision(3) << counters.nanoseconds / 1e6
+				<< " ms";
+			if (counters.bytes > 0)
+				out << std::setw(12) << std::setprecision(2)
+					<< counters.bytes / 1e6 << " MB" << std::setw(10)
+					<< counters.bytes / 1e6 / (counters.nanoseconds / 1e9)
+					<< " MB/s";
+			out << std::endl;
+		}
+	}
+}
+
+static void	writeString(std::ostream &out, const std::string &text)
+{
+	out << '"';
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] == '"' || text[i] == '\\')
+			out << '\\';
+		out << text[i];
+	}
+	out << '"';
+}
+
+// Chrome trace event format ("X" complete events, microseconds), for
+// chrome://tracing, Perfetto or speedscope.
+bool	Profiler::writeTrace(const std::string &path, std::string &error) const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	std::ofstream				file(path);
+
+	if (!file.is_open())
+	{
+		error = "cannot open " + path;
+		return (false);
+	}
+	file << "{\"displayTimeUnit\":\"ms\",\"droppedSpans\":" << _dropped
+		 << ",\"traceEvents\":[\n";
+	file << std::fixed << std::setprecision(3);
+	for (size_t s = 0; s < _spans.size(); s++)
+	{
+		const Span	&span = _spans[s];
+
+		file << "{\"name\":\"" << PHASE_NAMES[span.phase] << "\",\"cat\":";
+		writeString(file, _modes[span.mode].name);
+		file << ",\"ph\":\"X\",\"ts\":" << span.start / 1e3
+			 << ",\"dur\":" << span.duration / 1e3
+			 << ",\"pid\":1,\"tid\":" << span.thread
+			 << ",\"args\":{\"mode\":";
+		writeString(file, _modes[span.mode].name);
+		file << ",\"bytes\":" << span.bytes << "}}"
+			 << (s + 1 < _spans.size() ? ",\n" : "\n");
+	}
+	file << "]}\n";
+	file.close();
+	if (file.fail())
+	{
+		error = "write failed on " + path;
+		return (false);
+	}
+	return (true);
+}
+
+const char	*Profiler::phaseName(ProfilePhase phase)
+{
+	return (PHASE_NAMES[phase]);
+}
+
+ScopedTimer::ScopedTimer(const std::string &mode, ProfilePhase phase,
+		bool trace)
+	: _mode(mode), _phase(phase), _trace(trace), _active(false), _start(0),
+	  _bytes(0)
+{
+	if (_mode.empty() || !Profiler::instance().enabled())
+		return ;
+	_active = true;
+	_start = Profiler::instance().now();
+}
+
+ScopedTimer::~ScopedTimer(void)
+{
+	if (_active)
+		Profiler::instance().record(_mode, _phase, _start,
+			Profiler::instance().now(), _bytes, _trace);
+}
+
+void	ScopedTimer::addBytes(uint64_t bytes)
+{
+	_bytes += bytes;
+}
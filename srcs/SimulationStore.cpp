@@ -0,0 +1,135 @@
+#include "SimulationStore.hpp"
+#include <utility>
+
+const char	*eventTypeName(EventType type)
+{
+	switch (type)
+	{
+		case EVENT_REVEAL:
+			return ("reveal");
+		case EVENT_WIN_INFO:
+			return ("winInfo");
+		case EVENT_SET_WIN:
+			return ("setWin");
+		case EVENT_FINAL_WIN:
+			return ("finalWin");
+	}
+	return ("unknown");
+}
+
+GameEvent::GameEvent(void)
+	: multiplier(0.0), amount(0), index(0), type(EVENT_REVEAL)
+{
+}
+
+GameEvent::GameEvent(int idx, EventType t, double mult, int amt)
+	: multiplier(mult), amount(amt), index(static_cast<uint16_t>(idx)),
+	  type(t)
+{
+}
+
+SimulationStore::SimulationStore(void)
+	: _eventOffsets(1, 0)
+{
+}
+
+SimulationStore::~SimulationStore(void)
+{
+}
+
+void	SimulationStore::clear(void)
+{
+	resize(0);
+}
+
+// Drops every event: counts have to be set again before buildEventIndex().
+void	SimulationStore::resize(size_t rows)
+{
+	_ids.resize(rows);
+	_weights.resize(rows);
+	_payouts.resize(rows);
+	_eventOffsets.assign(rows + 1, 0);
+	_events.clear();
+}
+
+size_t	SimulationStore::size(void) const
+{
+	return (_ids.size());
+}
+
+bool	SimulationStore::empty(void) const
+{
+	return (_ids.empty());
+}
+
+size_t	SimulationStore::memoryUsage(void) const
+{
+	return (_ids.capacity() * sizeof(uint64_t)
+		+ _weights.capacity() * sizeof(uint64_t)
+		+ _payouts.capacity() * sizeof(uint64_t)
+		+ _eventOffsets.capacity() * sizeof(uint64_t)
+		+ _events.capacity() * sizeof(GameEvent));
+}
+
+void	SimulationStore::setRow(size_t row, uint64_t id, uint64_t weight,
+		uint64_t payout)
+{
+	_ids[row] = id;
+	_weights[row] = weight;
+	_payouts[row] = payout;
+}
+
+// Exchanges the weight and payout of two rows; ids stay in place.
+void	SimulationStore::swapOutcomes(size_t a, size_t b)
+{
+	std::swap(_weights[a], _weights[b]);
+	std::swap(_payouts[a], _payouts[b]);
+}
+
+// Counts are parked in the next offset slot until buildEventIndex().
+void	SimulationStore::setEventCount(size_t row, size_t count)
+{
+	_eventOffsets[row + 1] = count;
+}
+
+void	SimulationStore::buildEventIndex(void)
+{
+	for (size_t i = 1; i < _eventOffsets.size(); i++)
+		_eventOffsets[i] += _eventOffsets[i - 1];
+	_events.resize(_eventOffsets.back());
+}
+
+GameEvent	*SimulationStore::eventSlot(size_t row)
+{
+	return (_events.data() + _eventOffsets[row]);
+}
+
+const std::vector<uint64_t>	&SimulationStore::ids(void) const
+{
+	return (_ids);
+}
+
+const std::vector<uint64_t>	&SimulationStore::weights(void) const
+{
+	return (_weights);
+}
+
+const std::vector<uint64_t>	&SimulationStore::payouts(void) const
+{
+	return (_payouts);
+}
+
+const std::vector<GameEvent>	&SimulationStore::events(void) const
+{
+	return (_events);
+}
+
+size_t	SimulationStore::eventBegin(size_t row) const
+{
+	return (_eventOffsets[row]);
+}
+
+size_t	SimulationStore::eventEnd(size_t row) const
+{
+	return (_eventOffsets[row + 1]);
+}
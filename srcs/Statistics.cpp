@@ -0,0 +1,298 @@
+#include "Statistics.hpp"
+#include <algorithm>
+#include <cmath>
+
+ModeStatistics::ModeStatistics(void)
+	: count(0), rtp(0.0), meanPayout(0.0), variance(0.0), stdDeviation(0.0),
+	  volatility(0.0), hitFrequency(0.0), minPayout(0.0), maxPayout(0.0)
+{
+}
+
+PayoutMoments::PayoutMoments(void)
+	: count(0), hits(0), minPayout(0), maxPayout(0), weightSum(0),
+	  weightedSum(0), payoutSum(0), payoutSquareSum(0)
+{
+	std::fill(histogram, histogram + HISTOGRAM_BINS, 0);
+}
+
+size_t	PayoutMoments::histogramBin(uint64_t payout)
+{
+	return (payout == 0 ? 0 : 64 - __builtin_clzll(payout));
+}
+
+// Rows go by chunks of 2048 summed in plain uint64_t, which the compiler can
+// vectorize. With payouts and weights below 2^26 no chunk sum can exceed
+// 2^63, so the sums are exact; a chunk with larger values is summed again
+// in 128 bits.
+void	PayoutMoments::add(const SimulationStore &store, size_t first,
+		size_t last)
+{
+	static const size_t		CHUNK = 2048;
+	static const uint64_t	SMALL = 1ULL << 26;
+	const uint64_t			*payouts = store.payouts().data();
+	const uint64_t			*weights = store.weights().data();
+
+	if (first >= last)
+		return ;
+	if (count == 0)
+	{
+		minPayout = payouts[first];
+		maxPayout = payouts[first];
+	}
+	for (size_t begin = first; begin < last; begin += CHUNK)
+	{
+		size_t		end = std::min(begin + CHUNK, last);
+		uint64_t	sum = 0;
+		uint64_t	squares = 0;
+		uint64_t	weightTotal = 0;
+		uint64_t	weighted = 0;
+		uint64_t	nonZero = 0;
+		uint64_t	low = payouts[begin];
+		uint64_t	high = 0;
+		uint64_t	heaviest = 0;
+
+		for (size_t i = begin; i < end; i++)
+			histogram[histogramBin(payouts[i])]++;
+		for (size_t i = begin; i < end; i++)
+		{
+			sum += payouts[i];
+			squares += payouts[i] * payouts[i];
+			weightTotal += weights[i];
+			weighted += weights[i] * payouts[i];
+			nonZero += (payouts[i] != 0);
+			low = std::min(low, payouts[i]);
+			high = std::max(high, payouts[i]);
+			heaviest = std::max(heaviest, weights[i]);
+		}
+		count += end - begin;
+		hits += nonZero;
+		minPayout = std::min(minPayout, low);
+		maxPayout = std::max(maxPayout, high);
+		if (high < SMALL && heaviest < SMALL)
+		{
+			payoutSum += sum;
+			payoutSquareSum += squares;
+			weightSum += weightTotal;
+			weightedSum += weighted;
+			continue ;
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			const unsigned __int128	payout = payouts[i];
+
+			payoutSum += payout;
+			payoutSquareSum += payout * payout;
+			weightSum += weights[i];
+			weightedSum += payout * weights[i];
+		}
+	}
+}
+
+// `rows` rounds of weight 1 paying `payout`, e.g. one multinomial count.
+void	PayoutMoments::addRepeated(uint64_t payout, uint64_t rows)
+{
+	const unsigned __int128	wide = payout;
+
+	if (rows == 0)
+		return ;
+	if (count == 0)
+	{
+		minPayout = payout;
+		maxPayout = payout;
+	}
+	count += rows;
+	hits += payout != 0 ? rows : 0;
+	minPayout = std::min(minPayout, payout);
+	maxPayout = std::max(maxPayout, payout);
+	weightSum += rows;
+	weightedSum += wide * rows;
+	payoutSum += wide * rows;
+	payoutSquareSum += wide * wide * rows;
+	histogram[histogramBin(payout)] += rows;
+}
+
+void	PayoutMoments::merge(const PayoutMoments &other)
+{
+	if (other.count == 0)
+		return ;
+	if (count == 0)
+	{
+		*this = other;
+		return ;
+	}
+	count += other.count;
+	hits += other.hits;
+	minPayout = std::min(minPayout, other.minPayout);
+	maxPayout = std::max(maxPayout, other.maxPayout);
+	weightSum += other.weightSum;
+	weightedSum += other.weightedSum;
+	payoutSum += other.payoutSum;
+	payoutSquareSum += other.payoutSquareSum;
+	for (size_t b = 0; b < HISTOGRAM_BINS; b++)
+		histogram[b] += other.histogram[b];
+}
+
+// The variance numerator n * sum(p^2) - sum(p)^2 is exact whenever it fits
+// in 128 bits (any realistic book); otherwise it falls back to long double.
+ModeStatistics	PayoutMoments::statistics(void) const
+{
+	const long double	scale = PAYOUT_SCALE;
+	ModeStatistics		stats;
+	long double			n;
+	long double			mean;
+
+	if (count == 0)
+		return (stats);
+	n = count;
+	mean = static_cast<long double>(payoutSum) / n;
+	stats.count = count;
+	if (weightSum > 0)
+		stats.rtp = static_cast<double>(
+			static_cast<long double>(weightedSum)
+			/ static_cast<long double>(weightSum) / scale);
+	stats.meanPayout = static_cast<double>(mean / scale);
+	if (payoutSquareSum <= ~static_cast<unsigned __int128>(0) / count)
+		stats.variance = static_cast<double>(static_cast<long double>(
+			payoutSquareSum * count - payoutSum * payoutSum)
+			/ (n * n) / (scale * scale));
+	else
+		stats.variance = static_cast<double>(std::max(0.0L,
+			static_cast<long double>(payoutSquareSum) / n - mean * mean)
+			/ (scale * scale));
+	stats.stdDeviation = std::sqrt(stats.variance);
+	if (stats.meanPayout >= 0.0001)
+		stats.volatility = stats.stdDeviation / stats.meanPayout;
+	stats.hitFrequency = static_cast<double>(hits / n * 100.0L);
+	stats.minPayout = static_cast<double>(minPayout / scale);
+	stats.maxPayout = static_cast<double>(maxPayout / scale);
+	return (stats);
+}
+
+// Normal-approximation half-width z * sd / sqrt(n) of the RTP of rows of
+// weight 1, e.g. z = 1.96 for 95%.
+double	PayoutMoments::rtpHalfWidth(double z) const
+{
+	if (count == 0)
+		return (0.0);
+	return (z * statistics().stdDeviation
+		/ std::sqrt(static_cast<double>(count)));
+}
+
+// Acklam's rational approximation (relative error below 1.2e-9).
+double	normalQuantile(double p)
+{
+	static const double	a[6] = {-3.969683028665376e+01, 2.209460984245205e+02,
+		-2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01,
+		2.506628277459239e+00};
+	static const double	b[5] = {-5.447609879822406e+01, 1.615858368580409e+02,
+		-1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01};
+	static const double	c[6] = {-7.784894002430293e-03, -3.223964580411365e-01,
+		-2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00,
+		2.938163982698783e+00};
+	static const double	d[4] = {7.784695709041462e-03, 3.224671290700398e-01,
+		2.445134137142996e+00, 3.754408661907416e+00};
+	double				q;
+	double				r;
+
+	if (p <= 0.0 || p >= 1.0)
+		return (p <= 0.0 ? -INFINITY : INFINITY);
+	if (p < 0.02425 || p > 1 - 0.02425)
+	{
+		q = std::sqrt(-2 * std::log(p < 0.5 ? p : 1 - p));
+		r = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q
+			+ c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+		return (p < 0.5 ? r : -r);
+	}
+	q = p - 0.5;
+	r = q * q;
+	return ((((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r
+		+ a[5]) * q / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r
+		+ b[4]) * r + 1));
+}
+
+LiveStatistics::LiveStatistics(void)
+	: _merged(0), _targetHalfWidth(0.0), _targetZ(0.0), _targetMinSd(0.0),
+	  _reached(false)
+{
+}
+
+LiveStatistics::~LiveStatistics(void)
+{
+}
+
+void	LiveStatistics::reset(size_t blocks)
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	_blocks.assign(blocks, PayoutMoments());
+	_ready.assign(blocks, false);
+	_merged = 0;
+	_targetHalfWidth = 0.0;
+	_targetZ = 0.0;
+	_targetMinSd = 0.0;
+	_reached = false;
+	_prefix = PayoutMoments();
+	_convergence.clear();
+}
+
+void	LiveStatistics::setTarget(double halfWidth, double z, double minSd)
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	_targetHalfWidth = halfWidth;
+	_targetZ = z;
+	_targetMinSd = minSd;
+}
+
+// Returns the number of blocks in the prefix after this one is recorded.
+size_t	LiveStatistics::addBlock(size_t block, const PayoutMoments &moments)
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+	ConvergencePoint			point;
+
+	_blocks[block] = moments;
+	_ready[block] = true;
+	while (!_reached && _merged < _ready.size() && _ready[_merged])
+	{
+		_prefix.merge(_blocks[_merged]);
+		_merged++;
+		point.count = _prefix.count;
+		point.rtp = _prefix.statistics().rtp;
+		point.halfWidth = _prefix.rtpHalfWidth(1.96);
+		_convergence.push_back(point);
+		if (_targetHalfWidth > 0.0 && _targetZ
+			* std::max(_prefix.statistics().stdDeviation, _targetMinSd)
+			/ std::sqrt(static_cast<double>(_prefix.count))
+			<= _targetHalfWidth)
+			_reached = true;
+	}
+	return (_merged);
+}
+
+bool	LiveStatistics::targetReached(void) const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	return (_reached);
+}
+
+size_t	LiveStatistics::prefixBlocks(void) const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	return (_merged);
+}
+
+PayoutMoments	LiveStatistics::prefix(void) const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	return (_prefix);
+}
+
+std::vector<ConvergencePoint>	LiveStatistics::convergence(void) const
+{
+	std::lock_guard<std::mutex>	lock(_mutex);
+
+	return (_convergence);
+}
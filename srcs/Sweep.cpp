@@ -0,0 +1,310 @@
+#include "Sweep.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+// Inclusive of `last` up to rounding: range(0, 1, 0.1) has 11 values.
+SweepAxis	SweepAxis::range(size_t row, SweepField field, double first,
+		double last, double step)
+{
+	SweepAxis	axis;
+	size_t		steps;
+
+	axis.row = row;
+	axis.field = field;
+	if (!(step > 0.0) || last < first)
+		return (axis);
+	steps = static_cast<size_t>(std::floor((last - first) / step + 1e-9));
+	for (size_t i = 0; i <= steps; i++)
+		axis.values.push_back(first + step * i);
+	return (axis);
+}
+
+SweepAxis	SweepAxis::grid(size_t row, SweepField field,
+		const std::vector<double> &values)
+{
+	SweepAxis	axis;
+
+	axis.row = row;
+	axis.field = field;
+	axis.values = values;
+	return (axis);
+}
+
+SweepOptions::SweepOptions(void)
+	: threads(0), simulations(0), seed(42)
+{
+}
+
+Sweep::Sweep(const std::vector<MultiplierConfig> &rows)
+	: _rows(rows)
+{
+	prepareFixed();
+}
+
+Sweep::~Sweep(void)
+{
+}
+
+// Weights must be non-negative integers and multipliers non-negative.
+bool	Sweep::addAxis(const SweepAxis &axis, std::string &error)
+{
+	if (axis.row >= _rows.size())
+	{
+		error = "row " + std::to_string(axis.row) + " out of range (mode has "
+			+ std::to_string(_rows.size()) + " rows)";
+		return (false);
+	}
+	if (axis.values.empty())
+	{
+		error = "row " + std::to_string(axis.row) + ": no values";
+		return (false);
+	}
+	if (variantCount() > SIZE_MAX / axis.values.size())
+	{
+		error = "too many variants";
+		return (false);
+	}
+	for (size_t i = 0; i < axis.values.size(); i++)
+	{
+		if (!(axis.values[i] >= 0.0) || (axis.field == SWEEP_WEIGHT
+				&& axis.values[i] != std::floor(axis.values[i])))
+		{
+			error = "row " + std::to_string(axis.row) + ": "
+				+ (axis.field == SWEEP_WEIGHT
+					? "weights must be non-negative integers"
+					: "multipliers must be non-negative");
+			return (false);
+		}
+	}
+	_axes.push_back(axis);
+	if (std::find(_touched.begin(), _touched.end(), axis.row)
+		== _touched.end())
+		_touched.push_back(axis.row);
+	prepareFixed();
+	return (true);
+}
+
+size_t	Sweep::axisCount(void) const
+{
+	return (_axes.size());
+}
+
+// 1 with no axis: the base paytable itself.
+size_t	Sweep::variantCount(void) const
+{
+	size_t	count;
+
+	count = 1;
+	for (size_t a = 0; a < _axes.size(); a++)
+		count *= _axes[a].values.size();
+	return (count);
+}
+
+double	Sweep::value(size_t variant, size_t axis) const
+{
+	for (size_t a = 0; a < axis; a++)
+		variant /= _axes[a].values.size();
+	return (_axes[axis].values[variant % _axes[axis].values.size()]);
+}
+
+// The full paytable of a variant.
+void	Sweep::variantRows(size_t variant,
+		std::vector<MultiplierConfig> &rows) const
+{
+	rows = _rows;
+	for (size_t a = 0; a < _axes.size(); a++)
+	{
+		MultiplierConfig	&row = rows[_axes[a].row];
+		double				v = value(variant, a);
+
+		if (_axes[a].field == SWEEP_WEIGHT)
+			row.weight = static_cast<uint64_t>(v);
+		else
+		{
+			row.multiplier = v;
+			row.payout = Distribution::payoutUnits(v);
+		}
+	}
+}
+
+void	Sweep::prepareFixed(void)
+{
+	std::vector<MultiplierConfig>	untouched;
+
+	for (size_t i = 0; i < _rows.size(); i++)
+	{
+		if (std::find(_touched.begin(), _touched.end(), i) == _touched.end())
+			untouched.push_back(_rows[i]);
+	}
+	_fixed = Distribution::analyzeRows(untouched);
+}
+
+// Distribution::analyzeRows of variantRows(variant), with the untouched
+// rows already summed in _fixed. `touched` is scratch space, one entry
+// per touched row.
+ModeStatistics	Sweep::evaluate(size_t variant,
+		std::vector<MultiplierConfig> &touched) const
+{
+	touched.resize(_touched.size());
+	for (size_t t = 0; t < _touched.size(); t++)
+		touched[t] = _rows[_touched[t]];
+	for (size_t a = 0; a < _axes.size(); a++)
+	{
+		MultiplierConfig	&row = touched[std::find(_touched.begin(),
+			_touched.end(), _axes[a].row) - _touched.begin()];
+		double				v = value(variant, a);
+
+		if (_axes[a].field == SWEEP_WEIGHT)
+			row.weight = static_cast<uint64_t>(v);
+		else
+			row.payout = Distribution::payoutUnits(v);
+	}
+	return (Distribution::analyzeRows(touched, _fixed).stats);
+}
+
+// Distribution::multinomialCounts of options.simulations rounds over the
+// variant's rows, straight into the moments.
+ModeStatistics	Sweep::simulate(size_t variant, const SweepOptions &options,
+		std::vector<MultiplierConfig> &rows) const
+{
+	std::mt19937_64			rng(streamSeed(options.seed, variant));
+	PayoutMoments			moments;
+	std::vector<uint64_t>	ends;
+
+	variantRows(variant, rows);
+	Distribution::multinomialCounts(rows, options.simulations, rng, ends);
+	for (size_t i = 0; i < rows.size(); i++)
+		moments.addRepeated(rows[i].payout,
+			ends[i] - (i > 0 ? ends[i - 1] : 0));
+	return (moments.statistics());
+}
+
+// Variants are split in chunks over a pool; results are stored by variant,
+// so they do not depend on the thread count. Simulated variants cost k
+// binomials each, hence the smaller chunks.
+void	Sweep::run(const SweepOptions &options,
+		std::vector<SweepResult> &results) const
+{
+	const size_t		CHUNK = options.simulations > 0 ? 64 : 4096;
+	std::atomic<size_t>	nextChunk(0);
+	size_t				variants;
+	size_t				chunks;
+	size_t				threads;
+
+	variants = variantCount();
+	results.resize(variants);
+	chunks = (variants + CHUNK - 1) / CHUNK;
+
+	auto	worker = [&]() {
+		std::vector<MultiplierConfig>	scratch;
+		size_t							chunk;
+
+		while ((chunk = nextChunk++) < chunks)
+		{
+			size_t	last = std::min(variants, (chunk + 1) * CHUNK);
+
+			for (size_t v = chunk * CHUNK; v < last; v++)
+			{
+				results[v].variant = v;
+				results[v].exact = evaluate(v, scratch);
+				results[v].simulated = options.simulations > 0
+					? simulate(v, options, scratch) : ModeStatistics();
+			}
+		}
+	};
+
+	threads = std::min(ThreadPool::resolveThreads(options.threads), chunks);
+	if (threads <= 1)
+	{
+		worker();
+		return ;
+	}
+	ThreadPool	pool(threads);
+
+	for (size_t t = 0; t < threads; t++)
+		pool.submit(worker);
+	pool.wait();
+}
+
+std::string	Sweep::axisName(size_t axis) const
+{
+	if (axis >= _axes.size())
+		return ("axis " + std::to_string(axis));
+	return ((_axes[axis].field == SWEEP_WEIGHT ? "w[" : "m[")
+		+ std::to_string(_axes[axis].row) + "]");
+}
+
+// One line per variant: its axis values, then RTP, hit frequency and
+// volatility (and the simulated RTP when there is one).
+void	Sweep::printTable(std::ostream &out,
+		const std::vector<SweepResult> &results) const
+{
+	bool	simulated;
+
+	simulated = !results.empty() && results[0].simulated.count > 0;
+	out << std::setw(8) << "Variant";
+	for (size_t a = 0; a < _axes.size(); a++)
+		out << std::setw(10) << axisName(a);
+	out << std::setw(10) << "RTP %" << std::setw(10) << "Hit %"
+		<< std::setw(11) << "Volatility";
+	if (simulated)
+		out << std::setw(10) << "Sim RTP %";
+	out << std::endl << std::fixed;
+	for (size_t r = 0; r < results.size(); r++)
+	{
+		out << std::setw(8) << results[r].variant;
+		for (size_t a = 0; a < _axes.size(); a++)
+			out << std::setprecision(_axes[a].field == SWEEP_WEIGHT ? 0 : 2)
+				<< std::setw(10) << value(results[r].variant, a);
+		out << std::setprecision(3)
+			<< std::setw(10) << results[r].exact.rtp * 100.0
+			<< std::setw(10) << results[r].exact.hitFrequency
+			<< std::setw(11) << results[r].exact.volatility;
+		if (simulated)
+			out << std::setw(10) << results[r].simulated.rtp * 100.0;
+		out << std::endl;
+	}
+}
+
+bool	Sweep::writeCSV(const std::string &path,
+		const std::vector<SweepResult> &results, std::string &error) const
+{
+	std::ofstream	file(path);
+
+	if (!file.is_open())
+	{
+		error = "cannot open " + path;
+		return (false);
+	}
+	file << "variant";
+	for (size_t a = 0; a < _axes.size(); a++)
+		file << ',' << axisName(a);
+	file << ",rtp,hitFrequency,volatility,variance,simulations,simulatedRtp"
+		 << '\n' << std::setprecision(10);
+	for (size_t r = 0; r < results.size(); r++)
+	{
+		file << results[r].variant;
+		for (size_t a = 0; a < _axes.size(); a++)
+			file << ',' << value(results[r].variant, a);
+		file << ',' << results[r].exact.rtp
+			 << ',' << results[r].exact.hitFrequency
+			 << ',' << results[r].exact.volatility
+			 << ',' << results[r].exact.variance
+			 << ',' << results[r].simulated.count
+			 << ',' << results[r].simulated.rtp << '\n';
+	}
+	file.close();
+	if (!file)
+	{
+		error = "cannot write " + path;
+		return (false);
+	}
+	return (true);
+}
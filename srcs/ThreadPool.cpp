@@ -0,0 +1,85 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(size_t threads)
+	: _pending(0), _stopping(false)
+{
+	threads = resolveThreads(threads);
+	for (size_t i = 0; i < threads; i++)
+		_workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool(void)
+{
+	{
+		std::unique_lock<std::mutex>	lock(_mutex);
+
+		_stopping = true;
+	}
+	_taskReady.notify_all();
+	for (size_t i = 0; i < _workers.size(); i++)
+		_workers[i].join();
+}
+
+void	ThreadPool::submit(const std::function<void(void)> &task)
+{
+	{
+		std::unique_lock<std::mutex>	lock(_mutex);
+
+		_tasks.push(task);
+		_pending++;
+	}
+	_taskReady.notify_one();
+}
+
+void	ThreadPool::wait(void)
+{
+	std::unique_lock<std::mutex>	lock(_mutex);
+
+	_allDone.wait(lock, [this]() { return (_pending == 0); });
+}
+
+size_t	ThreadPool::size(void) const
+{
+	return (_workers.size());
+}
+
+// 0 means "one thread per hardware thread".
+size_t	ThreadPool::resolveThreads(size_t requested)
+{
+	size_t	hardware;
+
+	if (requested > 0)
+		return (requested);
+	hardware = std::thread::hardware_concurrency();
+	if (hardware == 0)
+		return (1);
+	return (hardware);
+}
+
+void	ThreadPool::workerLoop(void)
+{
+	std::function<void(void)>	task;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex>	lock(_mutex);
+
+			_taskReady.wait(lock, [this]() {
+				return (_stopping || !_tasks.empty());
+			});
+			if (_tasks.empty())
+				return ;
+			task = _tasks.front();
+			_tasks.pop();
+		}
+		task();
+		{
+			std::unique_lock<std::mutex>	lock(_mutex);
+
+			_pending--;
+			if (_pending == 0)
+				_allDone.notify_all();
+		}
+	}
+}
@@ -0,0 +1,402 @@
+#include "WeightSolver.hpp"
+#include "Distribution.hpp"
+#include <algorithm>
+#include <cmath>
+
+SolverTargets::SolverTargets(void)
+	: rtp(0.0), hitFrequency(-1.0), volatility(-1.0), totalWeight(0),
+	  minWeight(1), tolerance(0.0001)
+{
+}
+
+SolverResult::SolverResult(void)
+	: solved(false), iterations(0)
+{
+}
+
+WeightSolver::WeightSolver(const std::vector<MultiplierConfig> &rows,
+		const SolverTargets &targets)
+	: _rows(rows), _targets(targets), _m(0), _total(0.0)
+{
+}
+
+WeightSolver::~WeightSolver(void)
+{
+}
+
+// One constraint row per target over all rows, each scaled so that its
+// largest coefficient is 1.
+void	WeightSolver::buildConstraints(void)
+{
+	const double	rtp = _targets.rtp;
+	size_t			k = _rows.size();
+
+	_m = 0;
+	_a[_m].assign(k, 1.0);
+	_b[_m++] = 1.0;
+	_a[_m] = _x;
+	_b[_m++] = rtp;
+	if (_targets.hitFrequency >= 0.0)
+	{
+		_a[_m].resize(k);
+		for (size_t i = 0; i < k; i++)
+			_a[_m][i] = _x[i] > 0.0 ? 1.0 : 0.0;
+		_b[_m++] = _targets.hitFrequency / 100.0;
+	}
+	if (_targets.volatility >= 0.0)
+	{
+		_a[_m].resize(k);
+		for (size_t i = 0; i < k; i++)
+			_a[_m][i] = _x[i] * _x[i];
+		_b[_m++] = rtp * rtp * (1.0 + _targets.volatility
+			* _targets.volatility);
+	}
+	for (size_t j = 0; j < _m; j++)
+	{
+		double	scale = 0.0;
+
+		for (size_t i = 0; i < k; i++)
+			scale = std::max(scale, std::fabs(_a[j][i]));
+		if (scale == 0.0)
+			continue ;
+		for (size_t i = 0; i < k; i++)
+			_a[j][i] /= scale;
+		_b[j] /= scale;
+	}
+}
+
+// Gaussian elimination with partial pivoting on the m x m system.
+static bool	solveLinear(double (*matrix)[4], double *rhs, size_t m)
+{
+	for (size_t col = 0; col < m; col++)
+	{
+		size_t	pivot = col;
+
+		for (size_t r = col + 1; r < m; r++)
+		{
+			if (std::fabs(matrix[r][col]) > std::fabs(matrix[pivot][col]))
+				pivot = r;
+		}
+		if (std::fabs(matrix[pivot][col]) < 1e-300)
+			return (false);
+		std::swap(matrix[col], matrix[pivot]);
+		std::swap(rhs[col], rhs[pivot]);
+		for (size_t r = col + 1; r < m; r++)
+		{
+			double	f = matrix[r][col] / matrix[col][col];
+
+			for (size_t c = col; c < m; c++)
+				matrix[r][c] -= f * matrix[col][c];
+			rhs[r] -= f * rhs[col];
+		}
+	}
+	for (size_t r = m; r-- > 0;)
+	{
+		for (size_t c = r + 1; c < m; c++)
+			rhs[r] -= matrix[r][c] * rhs[c];
+		rhs[r] /= matrix[r][r];
+	}
+	return (true);
+}
+
+// On entry p holds the current probabilities (fixed rows included); on
+// success, the projection. The free rows minimise
+// sum (p_i - q_i)^2 / (2 d_i) under A p = b, p_i >= low, so
+// p_i(lambda) = max(low, q_i + d_i a_i.lambda) and the dual
+// g(lambda) = sum (p_i - q_i)^2 / (2 d_i) - lambda.(A p - b) is concave
+// with gradient b - A p and Hessian -J. Newton steps on lambda with a
+// backtracking line search on g converge in a handful of steps; an
+// unreachable target makes g unbounded and the loop runs out.
+bool	WeightSolver::project(std::vector<double> &p, size_t &iterations)
+{
+	static const size_t	MAX_ITERATIONS = 200;
+	static const double	EPSILON = 1e-12;
+	size_t				k = _rows.size();
+	std::vector<double>	q(p);
+	std::vector<double>	d(k);
+	double				low;
+	double				lambda[MAX_TARGETS] = {0.0, 0.0, 0.0, 0.0};
+	double				residual[MAX_TARGETS];
+	double				dual;
+	double				norm;
+
+	low = static_cast<double>(_targets.minWeight) / _total;
+	for (size_t i = 0; i < k; i++)
+		d[i] = std::max(q[i], 0.1 / k);
+
+	// Sets p(l) and r = A p - b, returns g(l).
+	auto	evaluate = [&](const double *l, double *r) {
+		double	value = 0.0;
+
+		for (size_t i = 0; i < k; i++)
+		{
+			double	move = 0.0;
+
+			if (_fixed[i])
+				continue ;
+			for (size_t j = 0; j < _m; j++)
+				move += _a[j][i] * l[j];
+			p[i] = std::max(low, q[i] + d[i] * move);
+			value += (p[i] - q[i]) * (p[i] - q[i]) / (2.0 * d[i]);
+		}
+		for (size_t j = 0; j < _m; j++)
+		{
+			r[j] = -_b[j];
+			for (size_t i = 0; i < k; i++)
+				r[j] += _a[j][i] * p[i];
+			value -= l[j] * r[j];
+		}
+		return (value);
+	};
+
+	auto	maxNorm = [&](const double *r) {
+		double	worst = 0.0;
+
+		for (size_t j = 0; j < _m; j++)
+			worst = std::max(worst, std::fabs(r[j]));
+		return (worst);
+	};
+
+	dual = evaluate(lambda, residual);
+	norm = maxNorm(residual);
+	for (iterations = 0; iterations < MAX_ITERATIONS && norm >= EPSILON;
+		iterations++)
+	{
+		double	jacobian[MAX_TARGETS][MAX_TARGETS] = {};
+		double	step[MAX_TARGETS];
+		double	trial[MAX_TARGETS];
+		double	trialResidual[MAX_TARGETS];
+		double	trialDual;
+		double	slope;
+		double	t;
+
+		for (size_t i = 0; i < k; i++)
+		{
+			if (_fixed[i] || p[i] <= low)
+				continue ;
+			for (size_t r = 0; r < _m; r++)
+				for (size_t c = 0; c < _m; c++)
+					jacobian[r][c] += d[i] * _a[r][i] * _a[c][i];
+		}
+		for (size_t j = 0; j < _m; j++)
+		{
+			jacobian[j][j] += 1e-12;
+			step[j] = -residual[j];
+		}
+		if (!solveLinear(jacobian, step, _m))
+			return (false);
+		slope = 0.0;
+		for (size_t j = 0; j < _m; j++)
+			slope -= residual[j] * step[j];
+		for (t = 1.0; t > 1e-12; t /= 2.0)
+		{
+			for (size_t j = 0; j < _m; j++)
+				trial[j] = lambda[j] + t * step[j];
+			trialDual = evaluate(trial, trialResidual);
+			if (trialDual >= dual + 1e-4 * t * slope)
+				break ;
+		}
+		if (t <= 1e-12)
+			break ;
+		std::copy(trial, trial + _m, lambda);
+		std::copy(trialResidual, trialResidual + _m, residual);
+		dual = trialDual;
+		norm = maxNorm(residual);
+	}
+	evaluate(lambda, residual);
+	return (maxNorm(residual) < EPSILON);
+}
+
+// (value - target) / target, or value - target for a target of 0.
+static long double	relativeError(long double value, double target)
+{
+	return ((value - target) / (target > 0.0 ? target : 1.0));
+}
+
+// Sum of squared relative errors of the active targets (the ones
+// buildConstraints constrains), from the sums (weight, weight * x,
+// weight * x^2, hit weight).
+double	WeightSolver::targetError(const long double *sums) const
+{
+	long double	rtp;
+	long double	error;
+	long double	variance;
+
+	if (sums[0] <= 0)
+		return (INFINITY);
+	rtp = sums[1] / sums[0];
+	error = relativeError(rtp, _targets.rtp);
+	error *= error;
+	if (_targets.hitFrequency >= 0.0)
+	{
+		long double	hit = relativeError(sums[3] / sums[0] * 100.0L,
+			_targets.hitFrequency);
+
+		error += hit * hit;
+	}
+	if (_targets.volatility >= 0.0 && rtp > 0)
+	{
+		variance = std::max(0.0L, sums[2] / sums[0] - rtp * rtp);
+		long double	vol = relativeError(std::sqrt(variance) / rtp,
+			_targets.volatility);
+
+		error += vol * vol;
+	}
+	return (static_cast<double>(error));
+}
+
+// Every active target of the integer weights, within tolerance: RTP and
+// hit frequency (as a fraction of rounds) to tolerance, volatility to
+// tolerance * max(1, target). Returns false and sets `error` on a miss.
+bool	WeightSolver::checkTargets(const ModeStatistics &exact,
+		std::string &error) const
+{
+	const double	tolerance = _targets.tolerance;
+	double			miss;
+
+	if ((miss = std::fabs(exact.rtp - _targets.rtp)) > tolerance)
+		error = "integer weights miss the target RTP by "
+			+ std::to_string(miss);
+	else if (_targets.hitFrequency >= 0.0 && (miss = std::fabs(
+			exact.hitFrequency - _targets.hitFrequency)) > tolerance * 100.0)
+		error = "integer weights miss the target hit frequency by "
+			+ std::to_string(miss) + " points";
+	else if (_targets.volatility >= 0.0 && (miss = std::fabs(
+			exact.volatility - _targets.volatility))
+			> tolerance * std::max(1.0, _targets.volatility))
+		error = "integer weights miss the target volatility by "
+			+ std::to_string(miss);
+	else
+		return (true);
+	error += "; raise totalWeight";
+	return (false);
+}
+
+// Rounds p * total, then takes the best +/-1 move on a free row while it
+// lowers targetError. Sums are updated in O(1) per candidate move.
+void	WeightSolver::roundWeights(const std::vector<double> &p,
+		std::vector<uint64_t> &weights) const
+{
+	static const size_t	MAX_MOVES = 100000;
+	size_t				k = _rows.size();
+	long double			sums[4] = {0, 0, 0, 0};
+	double				current;
+
+	weights.resize(k);
+	for (size_t i = 0; i < k; i++)
+	{
+		if (_fixed[i])
+			weights[i] = _rows[i].weight;
+		else
+			weights[i] = std::max<uint64_t>(_targets.minWeight,
+				static_cast<uint64_t>(std::llround(p[i] * _total)));
+		sums[0] += weights[i];
+		sums[1] += weights[i] * static_cast<long double>(_x[i]);
+		sums[2] += weights[i] * static_cast<long double>(_x[i]) * _x[i];
+		sums[3] += _x[i] > 0.0 ? weights[i] : 0;
+	}
+	current = targetError(sums);
+	for (size_t move = 0; move < MAX_MOVES; move++)
+	{
+		size_t	bestRow = k;
+		int		bestDelta = 0;
+		double	best = current;
+
+		for (size_t i = 0; i < k; i++)
+		{
+			if (_fixed[i])
+				continue ;
+			for (int delta = -1; delta <= 1; delta += 2)
+			{
+				long double	trial[4];
+				double		error;
+
+				if (delta < 0 && weights[i] <= _targets.minWeight)
+					continue ;
+				trial[0] = sums[0] + delta;
+				trial[1] = sums[1] + delta * static_cast<long double>(_x[i]);
+				trial[2] = sums[2] + delta * static_cast<long double>(_x[i])
+					* _x[i];
+				trial[3] = sums[3] + (_x[i] > 0.0 ? delta : 0);
+				error = targetError(trial);
+				if (error < best)
+				{
+					best = error;
+					bestRow = i;
+					bestDelta = delta;
+				}
+			}
+		}
+		if (bestRow == k)
+			break ;
+		weights[bestRow] += bestDelta;
+		sums[0] += bestDelta;
+		sums[1] += bestDelta * static_cast<long double>(_x[bestRow]);
+		sums[2] += bestDelta * static_cast<long double>(_x[bestRow])
+			* _x[bestRow];
+		sums[3] += _x[bestRow] > 0.0 ? bestDelta : 0;
+		current = best;
+	}
+}
+
+bool	WeightSolver::solve(SolverResult &result)
+{
+	std::vector<MultiplierConfig>	solved;
+	std::vector<double>				p;
+	uint64_t						current;
+	size_t							k = _rows.size();
+
+	result = SolverResult();
+	current = 0;
+	for (size_t i = 0; i < k; i++)
+		current += _rows[i].weight;
+	_total = static_cast<double>(_targets.totalWeight > 0
+		? _targets.totalWeight : current);
+	if (k == 0 || _total <= 0.0)
+	{
+		result.error = "empty paytable";
+		return (false);
+	}
+	if (!(_targets.rtp > 0.0) || _targets.hitFrequency > 100.0)
+	{
+		result.error = "rtp must be positive and hitFrequency at most 100";
+		return (false);
+	}
+	_x.resize(k);
+	_fixed.assign(k, false);
+	p.resize(k);
+	for (size_t i = 0; i < k; i++)
+	{
+		_x[i] = static_cast<double>(_rows[i].payout) / PAYOUT_SCALE;
+		p[i] = current > 0 ? static_cast<double>(_rows[i].weight) / current
+			: 1.0 / k;
+	}
+	for (size_t f = 0; f < _targets.fixedRows.size(); f++)
+	{
+		if (_targets.fixedRows[f] >= k)
+		{
+			result.error = "fixed row " + std::to_string(
+				_targets.fixedRows[f]) + " out of range";
+			return (false);
+		}
+		_fixed[_targets.fixedRows[f]] = true;
+		p[_targets.fixedRows[f]] = _rows[_targets.fixedRows[f]].weight
+			/ _total;
+	}
+	buildConstraints();
+	if (!project(p, result.iterations))
+	{
+		result.error = "targets cannot be reached with these multipliers"
+			" and constraints";
+		return (false);
+	}
+	roundWeights(p, result.weights);
+	solved = _rows;
+	for (size_t i = 0; i < k; i++)
+		solved[i].weight = result.weights[i];
+	result.exact = Distribution::analyzeRows(solved).stats;
+	if (!checkTargets(result.exact, result.error))
+		return (false);
+	result.solved = true;
+	return (true);
+}
@@ -33,9 +33,13 @@ void	StatisticsWindow::render(ModeManager &modeManager)
 	if (_selectedModeIndex >= 0
 		&& _selectedModeIndex < (int)modeManager.getModeCount())
 	{
-		const ModeEntry	&mode = modeManager.getModes()[_selectedModeIndex];
+		const ModeEntry					&mode
+			= modeManager.getModes()[_selectedModeIndex];
+		std::vector<ConvergencePoint>	live;
 
-		if (!mode.simulated || !mode.stats.calculated)
+		if (modeManager.liveConvergence(_selectedModeIndex, live))
+			renderConvergence(live, ModeManager::analyze(mode).stats.rtp);
+		else if (!mode.simulated || !mode.stats.calculated)
 			renderNoDataWarning();
 		else
 		{
@@ -44,6 +48,8 @@ void	StatisticsWindow::render(ModeManager &modeManager)
 			ImGui::Separator();
 			renderDistributionChart(mode);
 			ImGui::Separator();
+			renderConvergence(mode.convergence, mode.exact.rtp);
+			ImGui::Separator();
 			renderRTPBar(mode);
 		}
 	}
@@ -112,6 +118,13 @@ void	StatisticsWindow::renderStatsTable(const ModeEntry &mode)
 			: ImVec4(0.3f, 1, 0.3f, 1));
 		ImGui::TextColored(rtpColor, "%.2f%%", rtp);
 
+		ImGui::TableNextRow();
+		ImGui::TableSetColumnIndex(0);
+		ImGui::Text("Exact RTP");
+		ImGui::TableSetColumnIndex(1);
+		ImGui::Text("%.2f%% (%+.2f)", mode.exact.rtp * 100.0,
+			(mode.rtp - mode.exact.rtp) * 100.0);
+
 		ImGui::TableNextRow();
 		ImGui::TableSetColumnIndex(0);
 		ImGui::Text("Hit Frequency");
@@ -282,6 +295,90 @@ void	StatisticsWindow::renderRTPBar(const ModeEntry &mode)
 	ImGui::Dummy(ImVec2(0, barHeight + 25));
 }
 
+// Simulated RTP after each block with its 95% confidence band, against the
+// exact RTP of the paytable (dashed). The vertical range follows the second
+// half of the run, so the wide early band does not flatten the curve.
+void	StatisticsWindow::renderConvergence(
+		const std::vector<ConvergencePoint> &points, double exactRtp)
+{
+	ImGui::Spacing();
+	ImGui::TextColored(ImVec4(0.4f, 0.8f, 1.0f, 1.0f), "RTP Convergence");
+	ImGui::Spacing();
+
+	if (points.empty())
+		return ;
+
+	const ConvergencePoint	&last = points.back();
+
+	ImGui::Text("%llu rounds: %.3f%% +/- %.3f%% (95%%)",
+		static_cast<unsigned long long>(last.count), last.rtp * 100.0,
+		last.halfWidth * 100.0);
+
+	double	low = exactRtp;
+	double	high = exactRtp;
+	for (size_t i = points.size() / 2; i < points.size(); i++)
+	{
+		low = std::min(low, points[i].rtp - points[i].halfWidth);
+		high = std::max(high, points[i].rtp + points[i].halfWidth);
+	}
+	double	pad = std::max((high - low) * 0.1, 1e-6);
+	low -= pad;
+	high += pad;
+
+	float	width = ImGui::GetContentRegionAvail().x - 20;
+	float	height = 140.0f;
+	ImVec2	pos = ImGui::GetCursorScreenPos();
+	ImVec2	end = ImVec2(pos.x + width, pos.y + height);
+	ImDrawList	*drawList = ImGui::GetWindowDrawList();
+
+	auto	toX = [&](uint64_t count) {
+		return (pos.x + width * static_cast<float>(count) / last.count);
+	};
+	auto	toY = [&](double rtp) {
+		return (pos.y + height * static_cast<float>((high - rtp)
+			/ (high - low)));
+	};
+
+	drawList->AddRectFilled(pos, end, IM_COL32(30, 30, 30, 255));
+	drawList->PushClipRect(pos, end, true);
+	for (size_t i = 1; i < points.size(); i++)
+	{
+		const ConvergencePoint	&a = points[i - 1];
+		const ConvergencePoint	&b = points[i];
+
+		drawList->AddQuadFilled(
+			ImVec2(toX(a.count), toY(a.rtp + a.halfWidth)),
+			ImVec2(toX(b.count), toY(b.rtp + b.halfWidth)),
+			ImVec2(toX(b.count), toY(b.rtp - b.halfWidth)),
+			ImVec2(toX(a.count), toY(a.rtp - a.halfWidth)),
+			IM_COL32(80, 140, 230, 70));
+	}
+	for (float x = pos.x; x < end.x; x += 12)
+	{
+		drawList->AddLine(ImVec2(x, toY(exactRtp)),
+			ImVec2(std::min(x + 6, end.x), toY(exactRtp)),
+			IM_COL32(200, 200, 200, 200));
+	}
+	for (size_t i = 1; i < points.size(); i++)
+	{
+		drawList->AddLine(
+			ImVec2(toX(points[i - 1].count), toY(points[i - 1].rtp)),
+			ImVec2(toX(points[i].count), toY(points[i].rtp)),
+			IM_COL32(80, 255, 80, 255), 1.5f);
+	}
+	drawList->PopClipRect();
+
+	char	label[32];
+	snprintf(label, sizeof(label), "%.2f%%", high * 100.0);
+	drawList->AddText(ImVec2(pos.x + 2, pos.y + 2),
+		IM_COL32(150, 150, 150, 255), label);
+	snprintf(label, sizeof(label), "%.2f%%", low * 100.0);
+	drawList->AddText(ImVec2(pos.x + 2, end.y - 16),
+		IM_COL32(150, 150, 150, 255), label);
+
+	ImGui::Dummy(ImVec2(0, height + 5));
+}
+
 void	StatisticsWindow::renderNoDataWarning(void)
 {
 	ImGui::Spacing();
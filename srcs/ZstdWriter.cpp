@@ -0,0 +1,286 @@
+#include "ZstdWriter.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+CompressionSettings::CompressionSettings(void)
+	: level(3), workers(0), longDistance(false), windowLog(0)
+{
+}
+
+// Throughput first: cheapest level, every core.
+CompressionSettings	CompressionSettings::fast(void)
+{
+	CompressionSettings	settings;
+
+	settings.level = 1;
+	settings.workers = static_cast<int>(std::thread::hardware_concurrency());
+	return (settings);
+}
+
+// Size first: a 128 MB long-distance window is where repetitive books gain
+// the most (still decodable without --long). Levels above 12 cost orders of
+// magnitude more time on books for a few percent of size.
+CompressionSettings	CompressionSettings::small(void)
+{
+	CompressionSettings	settings;
+
+	settings.level = 12;
+	settings.workers = static_cast<int>(std::thread::hardware_concurrency());
+	settings.longDistance = true;
+	settings.windowLog = 27;
+	return (settings);
+}
+
+// The settings for one of `writers` files compressed at once: the workers
+// are shared out so the writers together keep to the requested count
+// (at least one each, so a multithreaded setting stays multithreaded).
+CompressionSettings	CompressionSettings::splitAcross(size_t writers) const
+{
+	CompressionSettings	settings(*this);
+
+	if (settings.workers > 0 && writers > 1)
+		settings.workers = std::max(1, static_cast<int>(
+			static_cast<size_t>(settings.workers) / writers));
+	return (settings);
+}
+
+ZstdWriter::ZstdWriter(void)
+	: _cctx(NULL), _cdict(NULL), _level(0), _inUsed(0), _seekable(false),
+	  _frameIn(0), _frameOut(0)
+{
+}
+
+ZstdWriter::~ZstdWriter(void)
+{
+	release();
+}
+
+// Frees the context and dictionary of the last open(), and closes its file
+// if close() did not (e.g. after an error).
+void	ZstdWriter::release(void)
+{
+	if (_cctx)
+		ZSTD_freeCCtx(_cctx);
+	if (_cdict)
+		ZSTD_freeCDict(_cdict);
+	_cctx = NULL;
+	_cdict = NULL;
+	if (_file.is_open())
+		_file.close();
+	_file.clear();
+}
+
+// `profile` names the mode whose compress and write times this writer
+// reports to the Profiler. A writer can be opened again, closed or not: it
+// then starts over on the new file, as a plain (not seekable) writer.
+bool	ZstdWriter::open(const std::string &path,
+		const CompressionSettings &settings, const std::string &profile)
+{
+	release();
+	_error.clear();
+	_profile = profile;
+	_seekable = false;
+	_cctx = ZSTD_createCCtx();
+	if (!_cctx)
+		return (fail("cannot create ZSTD context"));
+	if (!setParameter(ZSTD_c_compressionLevel, settings.level))
+		return (false);
+	_level = settings.level;
+	// A libzstd built without multithreading rejects nbWorkers: keep going
+	// single-threaded rather than failing the export.
+	if (settings.workers > 0)
+		ZSTD_CCtx_setParameter(_cctx, ZSTD_c_nbWorkers, settings.workers);
+	if (settings.longDistance
+		&& !setParameter(ZSTD_c_enableLongDistanceMatching, 1))
+		return (false);
+	if (settings.windowLog > 0
+		&& !setParameter(ZSTD_c_windowLog, settings.windowLog))
+		return (false);
+	_file.open(path, std::ios::binary);
+	if (!_file.is_open())
+		return (fail("cannot open " + path));
+	_in.resize(ZSTD_CStreamInSize());
+	_out.resize(ZSTD_CStreamOutSize());
+	_inUsed = 0;
+	_frameIn = 0;
+	_frameOut = 0;
+	_frames.clear();
+	return (true);
+}
+
+void	ZstdWriter::setSeekable(bool seekable)
+{
+	_seekable = seekable;
+}
+
+// Call after open() and before the first write.
+bool	ZstdWriter::setDictionary(const std::string &dictionary)
+{
+	size_t	ret;
+
+	if (!_error.empty())
+		return (false);
+	_cdict = ZSTD_createCDict(dictionary.data(), dictionary.size(), _level);
+	if (!_cdict)
+		return (fail("cannot load ZSTD dictionary"));
+	ret = ZSTD_CCtx_refCDict(_cctx, _cdict);
+	if (ZSTD_isError(ret))
+		return (fail(std::string("ZSTD: ") + ZSTD_getErrorName(ret)));
+	return (true);
+}
+
+bool	ZstdWriter::write(const char *data, size_t size)
+{
+	size_t	chunk;
+
+	if (!_error.empty())
+		return (false);
+	while (size > 0)
+	{
+		chunk = std::min(size, _in.size() - _inUsed);
+		memcpy(_in.data() + _inUsed, data, chunk);
+		_inUsed += chunk;
+		data += chunk;
+		size -= chunk;
+		if (_inUsed == _in.size() && !compress(ZSTD_e_continue))
+			return (false);
+	}
+	return (true);
+}
+
+bool	ZstdWriter::setParameter(ZSTD_cParameter param, int value)
+{
+	size_t	ret;
+
+	ret = ZSTD_CCtx_setParameter(_cctx, param, value);
+	if (ZSTD_isError(ret))
+		return (fail(std::string("ZSTD: ") + ZSTD_getErrorName(ret)));
+	return (true);
+}
+
+// Compresses the staged input; with ZSTD_e_end also closes the frame.
+bool	ZstdWriter::compress(ZSTD_EndDirective directive)
+{
+	ZSTD_inBuffer	input = {_in.data(), _inUsed, 0};
+	ZSTD_outBuffer	output;
+	size_t			remaining;
+	bool			done;
+
+	done = false;
+	while (!done)
+	{
+		output = {_out.data(), _out.size(), 0};
+		{
+			ScopedTimer	timer(_profile, PROFILE_COMPRESS);
+			size_t		consumed = input.pos;
+
+			remaining = ZSTD_compressStream2(_cctx, &output, &input,
+				directive);
+			timer.addBytes(input.pos - consumed);
+			_frameIn += input.pos - consumed;
+		}
+		if (ZSTD_isError(remaining))
+			return (fail(std::string("ZSTD compression failed: ")
+				+ ZSTD_getErrorName(remaining)));
+		if (output.pos > 0)
+		{
+			ScopedTimer	timer(_profile, PROFILE_WRITE);
+
+			_file.write(_out.data(), output.pos);
+			timer.addBytes(output.pos);
+			_frameOut += output.pos;
+		}
+		if (!_file)
+			return (fail("write failed"));
+		if (directive == ZSTD_e_end)
+			done = (remaining == 0);
+		else
+			done = (input.pos == input.size);
+	}
+	_inUsed = 0;
+	return (true);
+}
+
+// Closes the current frame; the next write starts a new one. Sizes are
+// recorded for the seek table, which caps a frame at 4 GB either way.
+bool	ZstdWriter::endFrame(void)
+{
+	if (!_error.empty())
+		return (false);
+	if (!compress(ZSTD_e_end))
+		return (false);
+	if (_frameIn > UINT32_MAX || _frameOut > UINT32_MAX)
+		return (fail("seekable frame larger than 4 GB"));
+	if (_frames.size() >= MAX_FRAMES)
+		return (fail("too many seekable frames"));
+	_frames.push_back(std::make_pair(static_cast<uint32_t>(_frameOut),
+		static_cast<uint32_t>(_frameIn)));
+	_frameIn = 0;
+	_frameOut = 0;
+	return (true);
+}
+
+static void	appendLE32(std::vector<char> &out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+// Skippable frame header, one (compressed, decompressed) entry per frame,
+// then the footer: frame count, descriptor (no checksums), magic.
+bool	ZstdWriter::writeSeekTable(void)
+{
+	std::vector<char>	table;
+
+	table.reserve(8 + _frames.size() * SEEK_ENTRY_SIZE + SEEK_FOOTER_SIZE);
+	appendLE32(table, SKIPPABLE_MAGIC);
+	appendLE32(table, static_cast<uint32_t>(_frames.size() * SEEK_ENTRY_SIZE
+		+ SEEK_FOOTER_SIZE));
+	for (size_t f = 0; f < _frames.size(); f++)
+	{
+		appendLE32(table, _frames[f].first);
+		appendLE32(table, _frames[f].second);
+	}
+	appendLE32(table, static_cast<uint32_t>(_frames.size()));
+	table.push_back(0);
+	appendLE32(table, SEEKABLE_MAGIC);
+	_file.write(table.data(), table.size());
+	if (!_file)
+		return (fail("write failed"));
+	return (true);
+}
+
+// A seekable file always ends its last frame (unless it is empty and not
+// the only one) and its seek table.
+bool	ZstdWriter::close(void)
+{
+	if (!_error.empty())
+		return (false);
+	if (_seekable)
+	{
+		if ((_inUsed > 0 || _frameIn > 0 || _frames.empty()) && !endFrame())
+			return (false);
+		if (!writeSeekTable())
+			return (false);
+	}
+	else if (!compress(ZSTD_e_end))
+		return (false);
+	_file.close();
+	if (_file.fail())
+		return (fail("close failed"));
+	release();
+	return (true);
+}
+
+const std::string	&ZstdWriter::error(void) const
+{
+	return (_error);
+}
+
+bool	ZstdWriter::fail(const std::string &message)
+{
+	_error = message;
+	return (false);
+}
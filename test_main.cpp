@@ -0,0 +1,630 @@
+#include "BatchRunner.hpp"
+#include "Distribution.hpp"
+#include "GameConfig.hpp"
+#include "Json.hpp"
+#include "Profiler.hpp"
+#include "Sweep.hpp"
+#include "ZstdWriter.hpp"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <zstd.h>
+#include <sys/stat.h>
+
+// Regression checks of the pipeline, run by `make test`. Every check prints
+// its name and whether it held; the exit status is 1 when any failed.
+// Files go to subdirectories of _dir, a scratch directory.
+class RegressionTests
+{
+	public:
+		explicit RegressionTests(const std::string &dir);
+		~RegressionTests(void);
+
+		bool	run(void);
+
+	private:
+		std::string	_dir;
+		size_t		_checks;
+		size_t		_failures;
+
+		void	check(bool condition, const std::string &what);
+		void	testEarlyStopping(void);
+		void	testAnalyzeRows(void);
+		void	testStreaming(void);
+		void	testBatchStreaming(void);
+		void	testSamplePayouts(void);
+		void	testZstdWriterReopen(void);
+		void	testCompressionConfig(void);
+		void	testPaytableConfig(void);
+		void	testWeightSolver(void);
+		void	testSweep(void);
+
+		std::string	exportMode(const Distribution &dist,
+						const std::string &name,
+						ExportOptions options = ExportOptions());
+		bool		sameFile(const std::string &a, const std::string &b);
+		void		removeExport(const std::string &name,
+						const std::string &mode);
+		static void	makePaytable(Distribution &dist,
+						const std::string &mode);
+		static bool	near(double value, double expected);
+		static std::vector<MultiplierConfig>	paytable(
+						const std::vector<std::pair<double, uint64_t> > &rows);
+		static bool	readFile(const std::string &path, std::string &data);
+		static bool	readBooks(const std::string &path, std::string &books);
+		static bool	runBatch(const std::string &config,
+						const std::string &dir, const std::string &trace);
+		static bool	phaseBounds(const std::string &trace, const char *phase,
+						double &first, double &last);
+};
+
+RegressionTests::RegressionTests(const std::string &dir)
+	: _dir(dir), _checks(0), _failures(0)
+{
+}
+
+RegressionTests::~RegressionTests(void)
+{
+}
+
+void	RegressionTests::check(bool condition, const std::string &what)
+{
+	_checks++;
+	if (!condition)
+		_failures++;
+	std::cout << (condition ? "  ok    " : "  FAIL  ") << what << std::endl;
+}
+
+void	RegressionTests::makePaytable(Distribution &dist,
+		const std::string &mode)
+{
+	dist.addMode(mode, 1.0);
+	dist.addMultiplier(mode, 0.0, 350);
+	dist.addMultiplier(mode, 0.5, 250);
+	dist.addMultiplier(mode, 1.5, 200);
+	dist.addMultiplier(mode, 2.0, 80);
+	dist.addMultiplier(mode, 50.0, 1);
+}
+
+// Relative tolerance, for values computed in floating point.
+bool	RegressionTests::near(double value, double expected)
+{
+	return (std::fabs(value - expected)
+		<= 1e-9 * std::max(1.0, std::fabs(expected)));
+}
+
+std::vector<MultiplierConfig>	RegressionTests::paytable(
+		const std::vector<std::pair<double, uint64_t> > &rows)
+{
+	std::vector<MultiplierConfig>	table(rows.size());
+
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		table[i].multiplier = rows[i].first;
+		table[i].weight = rows[i].second;
+		table[i].payout = Distribution::payoutUnits(rows[i].first);
+	}
+	return (table);
+}
+
+bool	RegressionTests::readFile(const std::string &path, std::string &data)
+{
+	std::ifstream		file(path, std::ios::binary);
+	std::ostringstream	content;
+
+	if (!file.is_open())
+		return (false);
+	content << file.rdbuf();
+	data = content.str();
+	return (true);
+}
+
+// Every frame of a books file, decompressed and concatenated (skippable
+// frames such as the seek table yield nothing).
+bool	RegressionTests::readBooks(const std::string &path, std::string &books)
+{
+	std::string		compressed;
+	std::string		chunk(ZSTD_DStreamOutSize(), '\0');
+	ZSTD_DStream	*stream;
+	ZSTD_inBuffer	in;
+	size_t			ret;
+
+	books.clear();
+	if (!readFile(path, compressed) || !(stream = ZSTD_createDStream()))
+		return (false);
+	in.src = compressed.data();
+	in.size = compressed.size();
+	in.pos = 0;
+	ret = 0;
+	while (in.pos < in.size)
+	{
+		ZSTD_outBuffer	out = {&chunk[0], chunk.size(), 0};
+
+		ret = ZSTD_decompressStream(stream, &out, &in);
+		if (ZSTD_isError(ret))
+			break ;
+		books.append(chunk.data(), out.pos);
+	}
+	ZSTD_freeDStream(stream);
+	return (!ZSTD_isError(ret) && ret == 0);
+}
+
+// exportAll into _dir/<name>, without dictionaries. Returns the directory.
+std::string	RegressionTests::exportMode(const Distribution &dist,
+		const std::string &name, ExportOptions options)
+{
+	const std::string	dir = _dir + "/" + name;
+
+	mkdir(dir.c_str(), 0755);
+	options.verbose = false;
+	check(dist.exportAll(dir, options), name + ": exportAll succeeds");
+	return (dir);
+}
+
+bool	RegressionTests::sameFile(const std::string &a, const std::string &b)
+{
+	std::string	first;
+	std::string	second;
+
+	return (readFile(a, first) && readFile(b, second) && first == second);
+}
+
+void	RegressionTests::removeExport(const std::string &name,
+		const std::string &mode)
+{
+	const std::string	dir = _dir + "/" + name;
+
+	std::remove((dir + "/books_" + mode + ".jsonl.zst").c_str());
+	std::remove((dir + "/lookUpTable_" + mode + "_0.csv").c_str());
+	std::remove((dir + "/index.json").c_str());
+	std::remove(dir.c_str());
+}
+
+// An early-stopped run keeps a prefix of whole blocks: its books must be
+// those of an uncapped run of the same length, events included.
+void	RegressionTests::testEarlyStopping(void)
+{
+	Distribution		early;
+	Distribution		full;
+	SimulationOptions	options;
+	std::string			earlyBooks;
+	std::string			fullBooks;
+	std::string			earlyCsv;
+	std::string			fullCsv;
+	size_t				count;
+
+	std::cout << "Early stopping" << std::endl;
+	makePaytable(early, "base");
+	makePaytable(full, "base");
+	options.targetHalfWidth = 0.01;
+	early.runSimulations("base", 10000000, 42, options);
+	count = early.simulationCount("base");
+	check(count > 0 && count < 10000000, "stops before the cap");
+	full.runSimulations("base", count, 42);
+	exportMode(early, "early");
+	exportMode(full, "full");
+	check(readBooks(_dir + "/early/books_base.jsonl.zst", earlyBooks)
+		&& readBooks(_dir + "/full/books_base.jsonl.zst", fullBooks),
+		"books decompress");
+	check(earlyBooks.find("\"events\":[]") == std::string::npos
+		&& earlyBooks.find("\"finalWin\"") != std::string::npos,
+		"every book has its events");
+	check(earlyBooks == fullBooks, "books equal an uncapped run's");
+	check(readFile(_dir + "/early/lookUpTable_base_0.csv", earlyCsv)
+		&& readFile(_dir + "/full/lookUpTable_base_0.csv", fullCsv)
+		&& earlyCsv == fullCsv, "lookup table equals an uncapped run's");
+	removeExport("early", "base");
+	removeExport("full", "base");
+
+	// 1,000,000x once in a million rounds: the first blocks have no hit and
+	// a sample sd of 0, yet the RTP is far from known
+	Distribution	jackpot;
+
+	jackpot.addMode("bonus", 1.0);
+	jackpot.addMultiplier("bonus", 0.0, 999999);
+	jackpot.addMultiplier("bonus", 1000000.0, 1);
+	jackpot.runSimulations("bonus", 1000000, 42, options);
+	check(jackpot.simulationCount("bonus") == 1000000,
+		"rare jackpot runs to the cap");
+}
+
+// Exact moments of small paytables, computed by hand. The last one has
+// weights near the configuration's 2^53 limit, where W * sum(w * p^2)
+// no longer fits in 128 bits.
+void	RegressionTests::testAnalyzeRows(void)
+{
+	ModeStatistics	stats;
+
+	std::cout << "analyzeRows" << std::endl;
+	stats = Distribution::analyzeRows(paytable({{0.0, 3}, {1.0, 1}})).stats;
+	check(near(stats.rtp, 0.25) && near(stats.variance, 0.1875)
+		&& near(stats.volatility, std::sqrt(0.1875) / 0.25)
+		&& near(stats.hitFrequency, 25.0) && near(stats.minPayout, 0.0)
+		&& near(stats.maxPayout, 1.0), "[0 x3, 1x x1]");
+	stats = Distribution::analyzeRows(paytable({{0.0, 1}, {2.0, 1},
+		{4.0, 2}, {7.5, 0}})).stats;
+	check(near(stats.rtp, 2.5) && near(stats.variance, 2.75)
+		&& near(stats.hitFrequency, 75.0) && near(stats.maxPayout, 4.0),
+		"[0 x1, 2x x1, 4x x2, 7.5x x0]");
+	stats = Distribution::analyzeRows(paytable({{0.0, 9000000000000000ULL},
+		{1000.0, 1000000000000000ULL}})).stats;
+	check(std::fabs(stats.rtp - 100.0) < 1e-6
+		&& std::fabs(stats.variance - 90000.0) < 1e-3
+		&& std::fabs(stats.volatility - 3.0) < 1e-9
+		&& std::fabs(stats.hitFrequency - 10.0) < 1e-9,
+		"[0 x9e15, 1000x x1e15] (beyond 128 bits)");
+}
+
+// streamSimulations must write the very bytes of runSimulations followed
+// by exportAll: blocks are generated out of order by several producers, but
+// formatted, framed and compressed in order. More threads than ring slots
+// share the fixed ring.
+void	RegressionTests::testStreaming(void)
+{
+	static const LookupTable	LOOKUPS[] = {LOOKUP_ROUNDS, LOOKUP_OBSERVED};
+	static const char			*NAMES[] = {"rounds", "observed"};
+	const size_t				count = 4 * Distribution::BLOCK_SIZE + 12345;
+
+	std::cout << "Streaming" << std::endl;
+	for (size_t l = 0; l < 2; l++)
+	{
+		Distribution		memory;
+		Distribution		stream;
+		SimulationOptions	simulation;
+		ExportOptions		options;
+		const std::string	dir = _dir + "/stream";
+		const std::string	what = std::string(NAMES[l]) + " lookup: ";
+
+		simulation.threads = Distribution::STREAM_RING_BLOCKS + 2;
+		simulation.engine = RNG_PHILOX;
+		options.lookup = LOOKUPS[l];
+		options.booksPerFrame = 1000;
+		options.verbose = false;
+		makePaytable(memory, "base");
+		makePaytable(stream, "base");
+		memory.runSimulations("base", count, 7, simulation);
+		exportMode(memory, "memory", options);
+		mkdir(dir.c_str(), 0755);
+		check(stream.streamSimulations("base", count, 7, dir, simulation,
+			options) && stream.exportIndex(dir + "/index.json"),
+			what + "streamSimulations succeeds");
+		check(stream.getStatistics("base").count == count
+			&& stream.getRTP("base") == memory.getRTP("base")
+			&& stream.getVariance("base") == memory.getVariance("base"),
+			what + "same statistics");
+		check(sameFile(_dir + "/memory/books_base.jsonl.zst",
+			dir + "/books_base.jsonl.zst"), what + "same books bytes");
+		check(sameFile(_dir + "/memory/lookUpTable_base_0.csv",
+			dir + "/lookUpTable_base_0.csv"), what + "same lookup table bytes");
+		check(sameFile(_dir + "/memory/index.json", dir + "/index.json"),
+			what + "same index.json");
+		removeExport("memory", "base");
+		removeExport("stream", "base");
+	}
+}
+
+// One game through BatchRunner, profiled into `trace`.
+bool	RegressionTests::runBatch(const std::string &config,
+		const std::string &dir, const std::string &trace)
+{
+	GameConfig	game;
+	BatchRunner	batch(2);
+	std::string	error;
+	bool		ok;
+
+	if (!GameConfig::parse(config, game, error)
+		|| !batch.add(game, dir, error))
+		return (false);
+	Profiler::instance().reset();
+	Profiler::instance().enable(true);
+	ok = batch.run();
+	Profiler::instance().enable(false);
+	ok = ok && Profiler::instance().writeTrace(trace, error);
+	Profiler::instance().reset();
+	return (ok);
+}
+
+// Earliest start and latest end (in microseconds) of the spans of `phase`.
+bool	RegressionTests::phaseBounds(const std::string &trace,
+		const char *phase, double &first, double &last)
+{
+	std::string			text;
+	std::string			error;
+	JsonValue			root;
+	const JsonValue		*events;
+	size_t				found;
+
+	if (!readFile(trace, text) || !JsonValue::parse(text, root, error)
+		|| !(events = root.find("traceEvents")))
+		return (false);
+	found = 0;
+	for (size_t i = 0; i < events->asArray().size(); i++)
+	{
+		const JsonValue	&event = events->asArray()[i];
+		double			start;
+		double			end;
+
+		if (event.find("name")->asString() != phase)
+			continue ;
+		start = event.find("ts")->asNumber();
+		end = start + event.find("dur")->asNumber();
+		first = found ? std::min(first, start) : start;
+		last = found ? std::max(last, end) : end;
+		found++;
+	}
+	return (found > 0);
+}
+
+// A streaming game in batch mode goes through streamSimulations: books are
+// compressed while later blocks are still generated, which an in-memory
+// run followed by exportAll never does. Both write the same files.
+void	RegressionTests::testBatchStreaming(void)
+{
+	const std::string	game = "\"simulations\": 600000, \"seed\": 5, "
+		"\"export\": {\"booksPerFrame\": 1000}, \"modes\": [{\"name\": "
+		"\"base\", \"multipliers\": [[0, 350], [0.5, 250], [1.5, 200], "
+		"[2, 80], [50, 1]]}]}";
+	const std::string	trace = _dir + "/trace.json";
+	const char			*FILES[] = {"/books_base.jsonl.zst",
+		"/lookUpTable_base_0.csv", "/index.json"};
+	double				generated[2][2];
+	double				compressed[2][2];
+	bool				same;
+
+	std::cout << "Batch streaming" << std::endl;
+	check(runBatch("{\"streaming\": true, " + game, _dir + "/stream", trace)
+		&& phaseBounds(trace, "generate", generated[0][0], generated[0][1])
+		&& phaseBounds(trace, "compress", compressed[0][0],
+			compressed[0][1]), "streaming config runs");
+	check(runBatch("{" + game, _dir + "/memory", trace)
+		&& phaseBounds(trace, "generate", generated[1][0], generated[1][1])
+		&& phaseBounds(trace, "compress", compressed[1][0],
+			compressed[1][1]), "in-memory config runs");
+	check(compressed[0][0] < generated[0][1],
+		"streaming compresses before the last block is generated");
+	check(compressed[1][0] >= generated[1][1],
+		"in-memory compresses after every block is generated");
+	same = true;
+	for (size_t f = 0; f < 3; f++)
+		same = same && sameFile(_dir + "/stream" + FILES[f],
+			_dir + "/memory" + FILES[f]);
+	check(same, "same files as the in-memory config");
+	std::remove(trace.c_str());
+	removeExport("stream", "base");
+	removeExport("memory", "base");
+}
+
+// samplePayouts and replaySimulation draw rounds as the rounds generation
+// does: same payouts as a stored run, across block boundaries.
+void	RegressionTests::testSamplePayouts(void)
+{
+	static const RngEngine	ENGINES[] = {RNG_MT19937, RNG_PHILOX};
+	static const char		*NAMES[] = {"mt19937", "philox"};
+	static const size_t		ROUNDS[] = {0, 1, Distribution::BLOCK_SIZE - 1,
+		Distribution::BLOCK_SIZE, Distribution::BLOCK_SIZE + 7,
+		2 * Distribution::BLOCK_SIZE + 99};
+	std::vector<uint64_t>	payouts(2 * Distribution::BLOCK_SIZE + 100);
+	bool					replayed;
+
+	std::cout << "samplePayouts" << std::endl;
+	for (size_t e = 0; e < 2; e++)
+	{
+		Distribution		dist;
+		SimulationOptions	options;
+
+		options.engine = ENGINES[e];
+		makePaytable(dist, "base");
+		dist.runSimulations("base", payouts.size(), 11, options);
+		check(dist.samplePayouts("base", 11, ENGINES[e], payouts)
+			&& payouts == dist.getSimulations("base").payouts(),
+			std::string(NAMES[e]) + ": same payouts as runSimulations");
+		replayed = true;
+		for (size_t r = 0; r < sizeof(ROUNDS) / sizeof(ROUNDS[0]); r++)
+		{
+			Simulation	sim;
+
+			replayed = replayed && dist.replaySimulation("base", ROUNDS[r] + 1,
+				11, options, sim) && sim.payoutMultiplier == payouts[ROUNDS[r]];
+		}
+		check(replayed, std::string(NAMES[e])
+			+ ": replaySimulation draws the same rounds");
+	}
+}
+
+// A writer opened again, without close(), drops the first file's context
+// and settings and writes a plain stream to the second.
+void	RegressionTests::testZstdWriterReopen(void)
+{
+	const std::string	first = _dir + "/first.zst";
+	const std::string	second = _dir + "/second.zst";
+	ZstdWriter			writer;
+	std::string			data;
+	bool				ok;
+
+	std::cout << "ZstdWriter" << std::endl;
+	ok = writer.open(first, CompressionSettings());
+	writer.setSeekable(true);
+	ok = ok && writer.setDictionary(std::string(4096, 'x'))
+		&& writer.write("abandoned\n", 10);
+	ok = ok && writer.open(second, CompressionSettings())
+		&& writer.write("book\n", 5) && writer.close();
+	check(ok && readBooks(second, data) && data == "book\n",
+		"reopened writer writes the second file");
+	std::remove(first.c_str());
+	std::remove(second.c_str());
+}
+
+// Compression fields are integers within the bounds of libzstd, rather
+// than any JSON number cast to int. Workers are
+// shared by the books files compressed at once.
+void	RegressionTests::testCompressionConfig(void)
+{
+	static const char	*REJECTED[] = {"{\"level\": 1e20}",
+		"{\"level\": 3.5}", "{\"level\": 23}", "{\"workers\": -1}",
+		"{\"workers\": 1.5}", "{\"windowLog\": 9}",
+		"{\"windowLog\": 32}"};
+	GameConfig			config;
+	CompressionSettings	settings;
+	std::string			error;
+
+	std::cout << "Compression settings" << std::endl;
+	for (size_t i = 0; i < sizeof(REJECTED) / sizeof(REJECTED[0]); i++)
+		check(!GameConfig::parse(std::string("{\"export\": {\"compression\": ")
+			+ REJECTED[i] + "}, \"modes\": [{\"name\": \"base\", "
+			"\"multipliers\": [[0, 1], [2, 1]]}]}", config, error),
+			std::string("rejects ") + REJECTED[i]);
+	check(GameConfig::parse("{\"export\": {\"compression\": {\"level\": -5, "
+		"\"workers\": 2, \"windowLog\": 0}}, \"modes\": [{\"name\": "
+		"\"base\", \"multipliers\": [[0, 1], [2, 1]]}]}", config, error)
+		&& config.exporting.compression.level == -5
+		&& config.exporting.compression.workers == 2
+		&& config.exporting.compression.windowLog == 0,
+		"accepts {\"level\": -5, \"workers\": 2, \"windowLog\": 0}");
+	settings.workers = 16;
+	check(settings.splitAcross(4).workers == 4
+		&& settings.splitAcross(32).workers == 1
+		&& settings.splitAcross(1).workers == 16
+		&& CompressionSettings().splitAcross(4).workers == 0,
+		"workers are split across the files written at once");
+}
+
+// Weights obey the same 2^53 bound in both forms, and a mode needs one
+// that is not 0 (unless a solver sets them).
+void	RegressionTests::testPaytableConfig(void)
+{
+	static const char	*REJECTED[] = {"[[0, 1], [2, 1e19]]",
+		"[[0, 1], [2, 1e300]]", "[[0, 1], {\"multiplier\": 2, "
+		"\"weight\": 1e19}]", "[[0, 0], [2, 0]]", "[[0, 1], [2, 0.5]]"};
+	GameConfig			config;
+	std::string			error;
+
+	std::cout << "Paytables" << std::endl;
+	for (size_t i = 0; i < sizeof(REJECTED) / sizeof(REJECTED[0]); i++)
+		check(!GameConfig::parse(std::string("{\"modes\": [{\"name\": "
+			"\"base\", \"multipliers\": ") + REJECTED[i] + "}]}", config,
+			error), std::string("rejects ") + REJECTED[i]);
+	check(!GameConfig::parse("{\"modes\": [{\"name\": \"bonus\", "
+		"\"multipliers\": [[0, 0], [2, 0]]}]}", config, error)
+		&& error.find("'bonus'") != std::string::npos,
+		"all-zero weights error names the mode");
+	check(GameConfig::parse("{\"modes\": [{\"name\": \"base\", "
+		"\"multipliers\": [[0, 9007199254740992], [2, 1]]}]}", config,
+		error), "accepts a weight of 2^53");
+}
+
+// Every active target is checked on the integer weights, and a target of
+// 0 is as active as any other.
+void	RegressionTests::testWeightSolver(void)
+{
+	SolverTargets	targets;
+	SolverResult	result;
+
+	std::cout << "Weight solver" << std::endl;
+	{
+		Distribution	dist;
+
+		// 10 rounds: RTP 0.5 is reachable, a hit frequency of 33% is not
+		dist.addMode("base", 1.0);
+		dist.addMultiplier("base", 0.0, 1);
+		dist.addMultiplier("base", 1.0, 1);
+		dist.addMultiplier("base", 2.0, 1);
+		targets.rtp = 0.5;
+		targets.hitFrequency = 33.0;
+		targets.totalWeight = 10;
+		targets.minWeight = 0;
+		check(!dist.solveWeights("base", targets, result)
+			&& result.error.find("hit frequency") != std::string::npos,
+			"a missed hit frequency fails");
+	}
+	{
+		Distribution	dist;
+
+		dist.addMode("base", 1.0);
+		dist.addMultiplier("base", 0.0, 1);
+		dist.addMultiplier("base", 1.0, 1);
+		dist.addMultiplier("base", 2.0, 1);
+		targets.rtp = 1.0;
+		targets.hitFrequency = -1.0;
+		targets.volatility = 0.0;
+		targets.totalWeight = 1000;
+		check(dist.solveWeights("base", targets, result)
+			&& result.exact.volatility < 1e-9 && result.weights[1] == 1000,
+			"a volatility of 0 is met");
+	}
+}
+
+// A variant's exact metrics, summed from the untouched rows plus the
+// touched ones, are analyzeRows of its whole paytable.
+void	RegressionTests::testSweep(void)
+{
+	Sweep							sweep(paytable({{0.0, 350}, {0.5, 250},
+		{1.5, 200}, {2.0, 0}, {50.0, 1}}));
+	std::vector<SweepResult>		results;
+	std::vector<MultiplierConfig>	rows;
+	std::string						error;
+	bool							same;
+
+	std::cout << "Sweep" << std::endl;
+	check(sweep.addAxis(SweepAxis::grid(3, SWEEP_WEIGHT, {0, 80}), error)
+		&& sweep.addAxis(SweepAxis::grid(4, SWEEP_MULTIPLIER, {0, 50, 500}),
+			error)
+		&& sweep.addAxis(SweepAxis::grid(0, SWEEP_WEIGHT, {0, 350}), error),
+		"axes accepted");
+	sweep.run(SweepOptions(), results);
+	same = results.size() == 12;
+	for (size_t v = 0; same && v < results.size(); v++)
+	{
+		const ModeStatistics	&exact = results[v].exact;
+		ModeStatistics			expected;
+
+		sweep.variantRows(v, rows);
+		expected = Distribution::analyzeRows(rows).stats;
+		same = exact.rtp == expected.rtp && exact.variance == expected.variance
+			&& exact.hitFrequency == expected.hitFrequency
+			&& exact.minPayout == expected.minPayout
+			&& exact.maxPayout == expected.maxPayout;
+	}
+	check(same, "every variant equals analyzeRows of its paytable");
+}
+
+bool	RegressionTests::run(void)
+{
+	testEarlyStopping();
+	testAnalyzeRows();
+	testStreaming();
+	testBatchStreaming();
+	testSamplePayouts();
+	testZstdWriterReopen();
+	testCompressionConfig();
+	testPaytableConfig();
+	testWeightSolver();
+	testSweep();
+	std::cout << std::endl << _checks - _failures << "/" << _checks
+			  << " checks passed" << std::endl;
+	return (_failures == 0);
+}
+
+int	main(int argc, char **argv)
+{
+	std::string	dir;
+	bool		ok;
+
+	(void)argv;
+	if (argc != 1)
+	{
+		std::cerr << "Usage: math-engine-test" << std::endl;
+		return (1);
+	}
+	if (!BatchRunner::createScratchDirectory("math-engine-test", dir))
+	{
+		std::cerr << "Error: cannot create a scratch directory" << std::endl;
+		return (1);
+	}
+	RegressionTests	tests(dir);
+
+	ok = tests.run();
+	BatchRunner::removeDirectories(dir);
+	return (ok ? 0 : 1);
+}